@@ -0,0 +1,436 @@
+// Бенчмарк SearchServer на синтетическом корпусе с распределением слов по закону Ципфа.
+// Результаты печатаются в stdout в формате JSON. Параметры: --name=value, см. ParseConfig.
+
+#include "../concurrent_search_server.h"
+#include "../corpus_loader.h"
+#include "../process_queries.h"
+#include "../search_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace std::chrono;
+
+struct BenchmarkConfig {
+    int document_count = 100'000;
+    int vocabulary_size = 50'000;
+    int document_length = 100;
+    int query_count = 10'000;
+    int query_length = 3;
+    double minus_word_ratio = 0.1;
+    double zipf_exponent = 1.0;
+    uint32_t seed = 42;
+};
+
+BenchmarkConfig ParseConfig(int argc, char* argv[]) {
+    BenchmarkConfig config;
+    for (int i = 1; i < argc; ++i) {
+        const string_view argument = argv[i];
+        const size_t equals = argument.find('=');
+        if (argument.substr(0, 2) != "--"sv || equals == argument.npos) {
+            throw invalid_argument("Expected --name=value, got "s + string(argument));
+        }
+        const string_view name = argument.substr(2, equals - 2);
+        const string value(argument.substr(equals + 1));
+        if (name == "documents"sv) {
+            config.document_count = stoi(value);
+        } else if (name == "vocabulary"sv) {
+            config.vocabulary_size = stoi(value);
+        } else if (name == "document-length"sv) {
+            config.document_length = stoi(value);
+        } else if (name == "queries"sv) {
+            config.query_count = stoi(value);
+        } else if (name == "query-length"sv) {
+            config.query_length = stoi(value);
+        } else if (name == "minus-ratio"sv) {
+            config.minus_word_ratio = stod(value);
+        } else if (name == "zipf"sv) {
+            config.zipf_exponent = stod(value);
+        } else if (name == "seed"sv) {
+            config.seed = static_cast<uint32_t>(stoul(value));
+        } else {
+            throw invalid_argument("Unknown option "s + string(name));
+        }
+    }
+    if (config.document_count <= 0 || config.vocabulary_size <= 0 || config.document_length <= 0
+            || config.query_count <= 0 || config.query_length <= 0) {
+        throw invalid_argument("Counts and lengths must be positive");
+    }
+    return config;
+}
+
+// Выбирает ранг слова с вероятностью, пропорциональной 1 / (rank + 1)^exponent
+class ZipfGenerator {
+public:
+    ZipfGenerator(int value_count, double exponent) {
+        cumulative_weights_.reserve(value_count);
+        double total = 0.0;
+        for (int rank = 0; rank < value_count; ++rank) {
+            total += 1.0 / pow(rank + 1.0, exponent);
+            cumulative_weights_.push_back(total);
+        }
+    }
+
+    int operator()(mt19937& generator) const {
+        const double point = uniform_real_distribution<double>(0.0, cumulative_weights_.back())(generator);
+        const auto it = lower_bound(cumulative_weights_.begin(), cumulative_weights_.end(), point);
+        return static_cast<int>(min<ptrdiff_t>(it - cumulative_weights_.begin(), cumulative_weights_.size() - 1));
+    }
+
+private:
+    vector<double> cumulative_weights_;
+};
+
+// Слово с номером rank записывается в системе счисления из латинских букв
+string MakeWord(int rank) {
+    string word;
+    do {
+        word += static_cast<char>('a' + rank % 26);
+        rank /= 26;
+    } while (rank > 0);
+    return word;
+}
+
+vector<string> GenerateDocuments(mt19937& generator, const ZipfGenerator& zipf, const vector<string>& vocabulary, const BenchmarkConfig& config) {
+    vector<string> documents;
+    documents.reserve(config.document_count);
+    uniform_int_distribution<int> length_distribution(1, 2 * config.document_length - 1);
+    for (int i = 0; i < config.document_count; ++i) {
+        string document;
+        for (int length = length_distribution(generator); length > 0; --length) {
+            document += vocabulary[zipf(generator)];
+            document += ' ';
+        }
+        documents.push_back(move(document));
+    }
+    return documents;
+}
+
+vector<string> GenerateQueries(mt19937& generator, const ZipfGenerator& zipf, const vector<string>& vocabulary, const BenchmarkConfig& config) {
+    vector<string> queries;
+    queries.reserve(config.query_count);
+    bernoulli_distribution is_minus_word(config.minus_word_ratio);
+    for (int i = 0; i < config.query_count; ++i) {
+        string query;
+        for (int j = 0; j < config.query_length; ++j) {
+            if (j > 0 && is_minus_word(generator)) {
+                query += '-';
+            }
+            query += vocabulary[zipf(generator)];
+            query += ' ';
+        }
+        queries.push_back(move(query));
+    }
+    return queries;
+}
+
+// Резидентная память процесса; 0, если платформа её не сообщает
+size_t GetResidentMemory() {
+#ifdef _WIN32
+    return 0;
+#else
+    ifstream statm("/proc/self/statm");
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    const long page_size = sysconf(_SC_PAGESIZE);
+    if (!(statm >> total_pages >> resident_pages) || page_size <= 0) {
+        return 0;
+    }
+    // statm считает в страницах, а они бывают и больше 4 КиБ (например, 16 или 64 КиБ на ARM)
+    return resident_pages * static_cast<size_t>(page_size);
+#endif
+}
+
+double GetPercentile(vector<double> values, double percentile) {
+    const size_t rank = static_cast<size_t>(ceil(percentile / 100.0 * values.size()));
+    const auto nth = values.begin() + (rank == 0 ? 0 : rank - 1);
+    nth_element(values.begin(), nth, values.end());
+    return *nth;
+}
+
+double GetMicroseconds(steady_clock::duration duration) {
+    return duration_cast<nanoseconds>(duration).count() / 1000.0;
+}
+
+// Средние по запросам значения счётчиков; в сборке без SEARCH_SERVER_METRICS — null
+string FormatSearchMetrics(const SearchMetrics& metrics) {
+    if (!SEARCH_METRICS_ENABLED || metrics.query_count == 0) {
+        return "null"s;
+    }
+    const double query_count = static_cast<double>(metrics.query_count);
+    return "{\"postings_scanned\": "s + to_string(metrics.total.postings_scanned / query_count)
+        + ", \"documents_matched\": "s + to_string(metrics.total.documents_matched / query_count)
+        + ", \"minus_word_removals\": "s + to_string(metrics.total.minus_word_removals / query_count)
+        + ", \"parse_us\": "s + to_string(GetMicroseconds(metrics.total.parse_time) / query_count)
+        + ", \"score_us\": "s + to_string(GetMicroseconds(metrics.total.score_time) / query_count)
+        + ", \"sort_us\": "s + to_string(GetMicroseconds(metrics.total.sort_time) / query_count) + "}"s;
+}
+
+template <typename Function>
+double MeasureMilliseconds(Function function) {
+    const auto start = steady_clock::now();
+    function();
+    return duration<double, milli>(steady_clock::now() - start).count();
+}
+
+// Пакет запросов: последовательный цикл против ProcessQueries и ProcessQueriesJoined
+string BenchmarkProcessQueries(const SearchServer& search_server, const vector<string>& queries) {
+    const double serial_ms = MeasureMilliseconds([&] {
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(query);
+        }
+    });
+    const double process_queries_ms = MeasureMilliseconds([&] {
+        ProcessQueries(search_server, queries);
+    });
+    const double process_queries_joined_ms = MeasureMilliseconds([&] {
+        ProcessQueriesJoined(search_server, queries);
+    });
+    return "{\"serial_ms\": "s + to_string(serial_ms)
+        + ", \"process_queries_ms\": "s + to_string(process_queries_ms)
+        + ", \"process_queries_joined_ms\": "s + to_string(process_queries_joined_ms) + "}"s;
+}
+
+// Полная сортировка всех найденных документов против частичной сортировки первых K
+string BenchmarkTopDocumentsSelection(const SearchServer& search_server, const vector<string>& queries, int document_count) {
+    const double full_sort_ms = MeasureMilliseconds([&] {
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(query, DocumentFilter{}, document_count);
+        }
+    });
+    const double partial_sort_ms = MeasureMilliseconds([&] {
+        for (const string& query : queries) {
+            search_server.FindTopDocuments(query);
+        }
+    });
+    return "{\"full_sort_ms\": "s + to_string(full_sort_ms)
+        + ", \"partial_sort_ms\": "s + to_string(partial_sort_ms) + "}"s;
+}
+
+// Задержки FindTopDocuments и FindTopDocumentsWithAllWords после CompressPostings; сервер остаётся сжатым
+string BenchmarkCompressedPostings(SearchServer& search_server, const vector<string>& queries) {
+    const double compress_ms = MeasureMilliseconds([&] {
+        search_server.CompressPostings();
+    });
+    vector<double> find_latencies;
+    vector<double> all_words_latencies;
+    find_latencies.reserve(queries.size());
+    all_words_latencies.reserve(queries.size());
+    for (const string& query : queries) {
+        auto start = steady_clock::now();
+        search_server.FindTopDocuments(query);
+        find_latencies.push_back(GetMicroseconds(steady_clock::now() - start));
+        start = steady_clock::now();
+        search_server.FindTopDocumentsWithAllWords(query);
+        all_words_latencies.push_back(GetMicroseconds(steady_clock::now() - start));
+    }
+    return "{\"compress_ms\": "s + to_string(compress_ms)
+        + ", \"find_top_documents_p50_us\": "s + to_string(GetPercentile(find_latencies, 50))
+        + ", \"find_top_documents_p99_us\": "s + to_string(GetPercentile(find_latencies, 99))
+        + ", \"with_all_words_p50_us\": "s + to_string(GetPercentile(all_words_latencies, 50))
+        + ", \"with_all_words_p99_us\": "s + to_string(GetPercentile(all_words_latencies, 99))
+        + ", \"postings_bytes\": "s + to_string(search_server.GetPostingsMemoryUsage()) + "}"s;
+}
+
+template <typename AddDocumentFunction, typename FindTopDocumentsFunction>
+void RunMixedWorkload(const vector<string>& documents, const vector<string>& queries,
+                      AddDocumentFunction add_document, FindTopDocumentsFunction find_top_documents) {
+    const int writer_count = 2;
+    const int reader_count = 6;
+    vector<thread> threads;
+    for (int writer = 0; writer < writer_count; ++writer) {
+        threads.emplace_back([&, writer] {
+            for (size_t i = writer; i < documents.size(); i += writer_count) {
+                add_document(static_cast<int>(i), documents[i]);
+            }
+        });
+    }
+    for (int reader = 0; reader < reader_count; ++reader) {
+        threads.emplace_back([&, reader] {
+            for (size_t i = reader; i < queries.size(); i += reader_count) {
+                find_top_documents(queries[i]);
+            }
+        });
+    }
+    for (thread& worker : threads) {
+        worker.join();
+    }
+}
+
+// Одновременные AddDocument и FindTopDocuments: SearchServer под общей блокировкой против ConcurrentSearchServer
+string BenchmarkMixedWorkload(const vector<string>& documents, const vector<string>& queries) {
+    const double global_lock_ms = MeasureMilliseconds([&] {
+        SearchServer search_server(""s);
+        shared_mutex server_mutex;
+        RunMixedWorkload(documents, queries,
+            [&](int document_id, const string& document) {
+                unique_lock lock(server_mutex);
+                search_server.AddDocument(document_id, document, DocumentStatus::ACTUAL, {1, 2, 3});
+            },
+            [&](const string& query) {
+                shared_lock lock(server_mutex);
+                search_server.FindTopDocuments(query);
+            });
+    });
+    const double concurrent_server_ms = MeasureMilliseconds([&] {
+        ConcurrentSearchServer search_server(""s);
+        RunMixedWorkload(documents, queries,
+            [&](int document_id, const string& document) {
+                search_server.AddDocument(document_id, document, DocumentStatus::ACTUAL, {1, 2, 3});
+            },
+            [&](const string& query) {
+                search_server.FindTopDocuments(query);
+            });
+    });
+    return "{\"global_lock_ms\": "s + to_string(global_lock_ms)
+        + ", \"concurrent_search_server_ms\": "s + to_string(concurrent_server_ms) + "}"s;
+}
+
+// AddDocument по одному против LoadCorpus из файла во временном каталоге
+string BenchmarkBulkLoad(const vector<string>& documents, uint32_t seed) {
+    const string corpus_path = (filesystem::temp_directory_path() / ("search_benchmark_corpus_"s + to_string(seed) + ".tsv"s)).string();
+    {
+        ofstream corpus(corpus_path);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            corpus << i << '\t' << static_cast<int>(DocumentStatus::ACTUAL) << '\t' << i % 10 << '\t' << documents[i] << '\n';
+        }
+    }
+    const double add_document_ms = MeasureMilliseconds([&] {
+        SearchServer search_server(""s);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {static_cast<int>(i % 10)});
+        }
+    });
+    const double load_corpus_ms = MeasureMilliseconds([&] {
+        SearchServer search_server(""s);
+        LoadCorpus(search_server, corpus_path);
+    });
+    filesystem::remove(corpus_path);
+    return "{\"add_document_ms\": "s + to_string(add_document_ms)
+        + ", \"load_corpus_ms\": "s + to_string(load_corpus_ms) + "}"s;
+}
+
+int main(int argc, char* argv[]) {
+    BenchmarkConfig config;
+    try {
+        config = ParseConfig(argc, argv);
+    } catch (const exception& error) {
+        cerr << error.what() << endl;
+        return 1;
+    }
+
+    mt19937 generator(config.seed);
+    const ZipfGenerator zipf(config.vocabulary_size, config.zipf_exponent);
+    vector<string> vocabulary;
+    vocabulary.reserve(config.vocabulary_size);
+    for (int rank = 0; rank < config.vocabulary_size; ++rank) {
+        vocabulary.push_back(MakeWord(rank));
+    }
+    const auto documents = GenerateDocuments(generator, zipf, vocabulary, config);
+    const auto queries = GenerateQueries(generator, zipf, vocabulary, config);
+
+    const size_t memory_before = GetResidentMemory();
+    SearchServer search_server(""s);
+    const auto add_start = steady_clock::now();
+    for (int i = 0; i < config.document_count; ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {i % 10});
+    }
+    const double add_seconds = duration<double>(steady_clock::now() - add_start).count();
+    const size_t memory_after = GetResidentMemory();
+
+    vector<double> find_latencies;
+    find_latencies.reserve(queries.size());
+    vector<int> matched_document_ids;
+    matched_document_ids.reserve(queries.size());
+    size_t found_count = 0;
+    ResetSearchMetrics();
+    for (const string& query : queries) {
+        const auto start = steady_clock::now();
+        const auto found = search_server.FindTopDocuments(query);
+        find_latencies.push_back(GetMicroseconds(steady_clock::now() - start));
+        found_count += found.size();
+        matched_document_ids.push_back(found.empty() ? static_cast<int>(matched_document_ids.size() % config.document_count) : found.front().id);
+    }
+
+    const SearchMetrics find_metrics = CollectSearchMetrics();
+
+    vector<double> all_words_latencies;
+    all_words_latencies.reserve(queries.size());
+    size_t all_words_found_count = 0;
+    ResetSearchMetrics();
+    for (const string& query : queries) {
+        const auto start = steady_clock::now();
+        const auto found = search_server.FindTopDocumentsWithAllWords(query);
+        all_words_latencies.push_back(GetMicroseconds(steady_clock::now() - start));
+        all_words_found_count += found.size();
+    }
+
+    const SearchMetrics all_words_metrics = CollectSearchMetrics();
+
+    vector<double> match_latencies;
+    match_latencies.reserve(queries.size());
+    size_t matched_word_count = 0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto start = steady_clock::now();
+        const auto [words, status] = search_server.MatchDocument(queries[i], matched_document_ids[i]);
+        match_latencies.push_back(GetMicroseconds(steady_clock::now() - start));
+        matched_word_count += words.size();
+    }
+
+    const string process_queries = BenchmarkProcessQueries(search_server, queries);
+    const string top_documents_selection = BenchmarkTopDocumentsSelection(search_server, queries, config.document_count);
+    const string mixed_workload = BenchmarkMixedWorkload(documents, queries);
+    const string bulk_load = BenchmarkBulkLoad(documents, config.seed);
+    const size_t postings_bytes = search_server.GetPostingsMemoryUsage();
+    const string compressed_postings = BenchmarkCompressedPostings(search_server, queries);
+
+    cout << "{\n"
+         << "  \"config\": {"
+         << "\"documents\": " << config.document_count
+         << ", \"vocabulary\": " << config.vocabulary_size
+         << ", \"document_length\": " << config.document_length
+         << ", \"queries\": " << config.query_count
+         << ", \"query_length\": " << config.query_length
+         << ", \"minus_ratio\": " << config.minus_word_ratio
+         << ", \"zipf\": " << config.zipf_exponent
+         << ", \"seed\": " << config.seed << "},\n"
+         << "  \"add_document\": {\"total_s\": " << add_seconds
+         << ", \"documents_per_s\": " << config.document_count / add_seconds << "},\n"
+         << "  \"find_top_documents\": {\"p50_us\": " << GetPercentile(find_latencies, 50)
+         << ", \"p99_us\": " << GetPercentile(find_latencies, 99)
+         << ", \"results\": " << found_count
+         << ", \"metrics\": " << FormatSearchMetrics(find_metrics) << "},\n"
+         << "  \"find_top_documents_with_all_words\": {\"p50_us\": " << GetPercentile(all_words_latencies, 50)
+         << ", \"p99_us\": " << GetPercentile(all_words_latencies, 99)
+         << ", \"results\": " << all_words_found_count
+         << ", \"metrics\": " << FormatSearchMetrics(all_words_metrics) << "},\n"
+         << "  \"match_document\": {\"p50_us\": " << GetPercentile(match_latencies, 50)
+         << ", \"p99_us\": " << GetPercentile(match_latencies, 99)
+         << ", \"matched_words\": " << matched_word_count << "},\n"
+         << "  \"process_queries\": " << process_queries << ",\n"
+         << "  \"top_documents_selection\": " << top_documents_selection << ",\n"
+         << "  \"mixed_read_write\": " << mixed_workload << ",\n"
+         << "  \"bulk_load\": " << bulk_load << ",\n"
+         << "  \"compressed_postings\": " << compressed_postings << ",\n"
+         << "  \"memory\": {\"resident_bytes\": " << (memory_after > memory_before ? memory_after - memory_before : 0)
+         << ", \"postings_bytes\": " << postings_bytes << "}\n"
+         << "}" << endl;
+}
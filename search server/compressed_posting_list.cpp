@@ -0,0 +1,28 @@
+#include "compressed_posting_list.h"
+
+CompressedPostingList::CompressedPostingList(const std::vector<std::pair<int, int>>& postings)
+    : size_(postings.size()) {
+    int previous_document_id = 0;
+    for (const auto& [document_id, term_count] : postings) {
+        WriteVarint(data_, static_cast<uint32_t>(document_id - previous_document_id));
+        WriteVarint(data_, static_cast<uint32_t>(term_count));
+        previous_document_id = document_id;
+    }
+    data_.shrink_to_fit();
+}
+
+size_t CompressedPostingList::Size() const {
+    return size_;
+}
+
+size_t CompressedPostingList::GetMemoryUsage() const {
+    return sizeof(*this) + data_.capacity();
+}
+
+void CompressedPostingList::WriteVarint(std::vector<uint8_t>& data, uint32_t value) {
+    while (value >= 0x80) {
+        data.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    data.push_back(static_cast<uint8_t>(value));
+}
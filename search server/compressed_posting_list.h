@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Список вхождений слова в сжатом виде. Для каждого документа по возрастанию id
+// хранятся varint разности с предыдущим id и varint числа вхождений слова в документ.
+class CompressedPostingList {
+public:
+    CompressedPostingList() = default;
+
+    // postings — пары (document_id, term_count), отсортированные по document_id
+    explicit CompressedPostingList(const std::vector<std::pair<int, int>>& postings);
+
+    size_t Size() const;
+    size_t GetMemoryUsage() const;
+
+    template <typename Function>
+    void ForEach(Function function) const;
+
+    // Чтение по одному вхождению, чтобы сливать несколько списков по id
+    class Reader {
+    public:
+        Reader() = default;
+        explicit Reader(const CompressedPostingList& list);
+
+        bool AtEnd() const;
+        int GetDocumentId() const;
+        int GetTermCount() const;
+        void Next();
+
+    private:
+        const uint8_t* data_ = nullptr;
+        const uint8_t* data_end_ = nullptr;
+        int document_id_ = 0;
+        int term_count_ = 0;
+        bool at_end_ = true;
+    };
+
+private:
+    std::vector<uint8_t> data_;
+    size_t size_ = 0;
+
+    static void WriteVarint(std::vector<uint8_t>& data, uint32_t value);
+    static uint32_t ReadVarint(const uint8_t*& data);
+};
+
+template <typename Function>
+void CompressedPostingList::ForEach(Function function) const {
+    const uint8_t* data = data_.data();
+    const uint8_t* const data_end = data + data_.size();
+    int document_id = 0;
+    while (data != data_end) {
+        document_id += static_cast<int>(ReadVarint(data));
+        const int term_count = static_cast<int>(ReadVarint(data));
+        function(document_id, term_count);
+    }
+}
+
+inline uint32_t CompressedPostingList::ReadVarint(const uint8_t*& data) {
+    uint32_t value = *data & 0x7F;
+    for (int shift = 7; *data++ & 0x80; shift += 7) {
+        value |= static_cast<uint32_t>(*data & 0x7F) << shift;
+    }
+    return value;
+}
+
+inline CompressedPostingList::Reader::Reader(const CompressedPostingList& list)
+    : data_(list.data_.data())
+    , data_end_(list.data_.data() + list.data_.size()) {
+    Next();
+}
+
+inline bool CompressedPostingList::Reader::AtEnd() const {
+    return at_end_;
+}
+
+inline int CompressedPostingList::Reader::GetDocumentId() const {
+    return document_id_;
+}
+
+inline int CompressedPostingList::Reader::GetTermCount() const {
+    return term_count_;
+}
+
+inline void CompressedPostingList::Reader::Next() {
+    at_end_ = data_ == data_end_;
+    if (!at_end_) {
+        document_id_ += static_cast<int>(ReadVarint(data_));
+        term_count_ = static_cast<int>(ReadVarint(data_));
+    }
+}
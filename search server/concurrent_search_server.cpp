@@ -0,0 +1,91 @@
+#include "concurrent_search_server.h"
+
+#include <functional>
+
+ConcurrentSearchServer::ConcurrentSearchServer(const std::string& stop_words_text, size_t shard_count, size_t max_result_document_count)
+        : ConcurrentSearchServer(std::string_view(stop_words_text), shard_count, max_result_document_count) {
+}
+
+ConcurrentSearchServer::ConcurrentSearchServer(std::string_view stop_words_text, size_t shard_count, size_t max_result_document_count)
+        : ConcurrentSearchServer(SplitIntoWords(stop_words_text), shard_count, max_result_document_count) {
+}
+
+void ConcurrentSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    const auto words = SplitIntoWordsNoStop(document, stop_words_);
+    const double inv_word_count = 1.0 / words.size();
+
+    std::map<std::string_view, double> word_freqs;
+    for (std::string_view word : words) {
+        word_freqs[word] += inv_word_count;
+    }
+
+    // id занимается сразу, но запросы не видят документ, пока он не опубликован
+    DocumentData* document_data = nullptr;
+    {
+        std::unique_lock documents_lock(documents_mutex_);
+        if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+            throw std::invalid_argument("Invalid document_id");
+        }
+        document_data = &documents_[document_id];
+        document_data->rating = ComputeAverageRating(ratings);
+        document_data->status = status;
+        document_data->word_count = static_cast<int>(words.size());
+    }
+
+    std::vector<std::vector<std::pair<std::string_view, double>>> shard_words(shards_.size());
+    for (const auto& [word, term_freq] : word_freqs) {
+        shard_words[GetShardIndex(word)].emplace_back(word, term_freq);
+    }
+    for (size_t shard_index = 0; shard_index < shards_.size(); ++shard_index) {
+        if (shard_words[shard_index].empty()) {
+            continue;
+        }
+        Shard& shard = shards_[shard_index];
+        std::unique_lock shard_lock(shard.mutex);
+        for (const auto& [word, term_freq] : shard_words[shard_index]) {
+            auto it = shard.word_to_postings.find(word);
+            if (it == shard.word_to_postings.end()) {
+                it = shard.word_to_postings.emplace(std::string(word), std::vector<Posting>{}).first;
+            }
+            auto& postings = it->second;
+            const Posting posting{document_id, status, term_freq, document_data};
+            if (postings.empty() || postings.back().document_id < document_id) {
+                postings.push_back(posting);
+            } else {
+                postings.insert(std::lower_bound(postings.begin(), postings.end(), document_id,
+                                                 [](const Posting& lhs, int id) { return lhs.document_id < id; }),
+                                posting);
+            }
+        }
+    }
+
+    std::unique_lock documents_lock(documents_mutex_);
+    document_data->publish_sequence.store(++publish_sequence_, std::memory_order_release);
+    ++published_document_count_;
+    published_word_count_ += document_data->word_count;
+}
+
+int ConcurrentSearchServer::GetDocumentCount() const {
+    std::shared_lock documents_lock(documents_mutex_);
+    return published_document_count_;
+}
+
+size_t ConcurrentSearchServer::GetShardIndex(std::string_view word) const {
+    return std::hash<std::string_view>{}(word) % shards_.size();
+}
+
+ConcurrentSearchServer::Snapshot ConcurrentSearchServer::TakeSnapshot() const {
+    std::shared_lock documents_lock(documents_mutex_);
+    Snapshot snapshot;
+    snapshot.publish_sequence = publish_sequence_;
+    snapshot.document_count = published_document_count_;
+    if (published_document_count_ > 0) {
+        snapshot.average_document_length = published_word_count_ / static_cast<double>(published_document_count_);
+    }
+    return snapshot;
+}
+
+bool ConcurrentSearchServer::IsVisible(const DocumentData& document_data, const Snapshot& snapshot) {
+    const uint64_t publish_sequence = document_data.publish_sequence.load(std::memory_order_acquire);
+    return publish_sequence != 0 && publish_sequence <= snapshot.publish_sequence;
+}
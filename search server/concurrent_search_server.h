@@ -0,0 +1,213 @@
+#pragma once
+
+#include "document.h"
+#include "ranking.h"
+#include "search_server.h"
+#include "string_processing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+const size_t DEFAULT_SHARD_COUNT = 16;
+
+// Индекс разбит на шарды по хэшу слова, у каждого шарда своя блокировка.
+// AddDocument и FindTopDocuments можно вызывать одновременно из разных потоков.
+// Документ публикуется только после того, как его слова разложены по всем шардам; запрос
+// под короткой блокировкой запоминает номер последней публикации и видит только документы,
+// опубликованные до него, поэтому число документов и частоты слов для IDF согласованы.
+class ConcurrentSearchServer {
+public:
+    // max_result_document_count — число результатов FindTopDocuments, если оно не задано в вызове
+    template <typename StringContainer>
+    explicit ConcurrentSearchServer(const StringContainer& stop_words, size_t shard_count = DEFAULT_SHARD_COUNT,
+                                    size_t max_result_document_count = MAX_RESULT_DOCUMENT_COUNT);
+
+    explicit ConcurrentSearchServer(const std::string& stop_words_text, size_t shard_count = DEFAULT_SHARD_COUNT,
+                                    size_t max_result_document_count = MAX_RESULT_DOCUMENT_COUNT);
+    explicit ConcurrentSearchServer(std::string_view stop_words_text, size_t shard_count = DEFAULT_SHARD_COUNT,
+                                    size_t max_result_document_count = MAX_RESULT_DOCUMENT_COUNT);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // RankingPolicy задаёт формулу релевантности так же, как в SearchServer (см. ranking.h)
+    template <typename RankingPolicy = TfIdfRanking, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+
+    template <typename RankingPolicy = TfIdfRanking>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+
+    template <typename RankingPolicy = TfIdfRanking>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    template <typename RankingPolicy = TfIdfRanking, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_document_count) const;
+
+    int GetDocumentCount() const;
+
+private:
+    struct DocumentData {
+        int rating = 0;
+        DocumentStatus status = DocumentStatus::ACTUAL;
+        int word_count = 0;
+        // 0, пока документ не опубликован, иначе номер его публикации
+        std::atomic<uint64_t> publish_sequence{0};
+    };
+
+    // Данные документа неизменны после AddDocument, а узлы std::map не переезжают,
+    // поэтому запрос читает их по указателю без блокировки documents_mutex_
+    struct Posting {
+        int document_id;
+        DocumentStatus status;
+        double term_freq;
+        const DocumentData* document_data;
+    };
+
+    struct Shard {
+        mutable std::shared_mutex mutex;
+        std::map<std::string, std::vector<Posting>, std::less<>> word_to_postings;
+    };
+
+    // Что запрос берёт под documents_mutex_; остальное он читает без этой блокировки
+    struct Snapshot {
+        uint64_t publish_sequence = 0;
+        int document_count = 0;
+        double average_document_length = 0.0;
+    };
+
+    // Вхождение слова в документ, видимый запросу
+    struct TermMatch {
+        int document_id;
+        double term_freq;
+        const DocumentData* document_data;
+    };
+
+    const std::set<std::string, std::less<>> stop_words_;
+    const size_t max_result_document_count_;
+    std::vector<Shard> shards_;
+    mutable std::shared_mutex documents_mutex_;
+    std::map<int, DocumentData> documents_;
+    uint64_t publish_sequence_ = 0;
+    int published_document_count_ = 0;
+    int64_t published_word_count_ = 0;
+
+    size_t GetShardIndex(std::string_view word) const;
+
+    Snapshot TakeSnapshot() const;
+
+    static bool IsVisible(const DocumentData& document_data, const Snapshot& snapshot);
+
+    // Опубликованные к snapshot вхождения слова; возвращает их число (частоту слова для IDF).
+    // Проверка статуса DocumentFilter выполняется здесь же, по списку вхождений.
+    template <typename DocumentPredicate>
+    int CollectTermMatches(std::string_view word, const Snapshot& snapshot, const DocumentPredicate& document_predicate,
+                           std::vector<TermMatch>& matches) const;
+};
+
+template <typename StringContainer>
+ConcurrentSearchServer::ConcurrentSearchServer(const StringContainer& stop_words, size_t shard_count, size_t max_result_document_count)
+    : stop_words_(MakeUniqueNonEmptyStrings(stop_words))
+    , max_result_document_count_(max_result_document_count)
+    , shards_(shard_count) {
+    if (!std::all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
+        throw std::invalid_argument("Some of stop words are invalid");
+    }
+    if (shard_count == 0) {
+        throw std::invalid_argument("Shard count must be positive");
+    }
+}
+
+template <typename DocumentPredicate>
+int ConcurrentSearchServer::CollectTermMatches(std::string_view word, const Snapshot& snapshot, const DocumentPredicate& document_predicate,
+                                               std::vector<TermMatch>& matches) const {
+    const Shard& shard = shards_[GetShardIndex(word)];
+    std::shared_lock shard_lock(shard.mutex);
+    const auto it = shard.word_to_postings.find(word);
+    if (it == shard.word_to_postings.end()) {
+        return 0;
+    }
+    int document_freq = 0;
+    for (const Posting& posting : it->second) {
+        if (!IsVisible(*posting.document_data, snapshot)) {
+            continue;
+        }
+        ++document_freq;
+        if constexpr (std::is_same_v<DocumentPredicate, DocumentFilter>) {
+            if (posting.status != document_predicate.status) {
+                continue;
+            }
+        }
+        matches.push_back({posting.document_id, posting.term_freq, posting.document_data});
+    }
+    return document_freq;
+}
+
+template <typename RankingPolicy, typename DocumentPredicate>
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    return FindTopDocuments<RankingPolicy>(raw_query, document_predicate, max_result_document_count_);
+}
+
+template <typename RankingPolicy>
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments<RankingPolicy>(raw_query, DocumentFilter{status});
+}
+
+template <typename RankingPolicy>
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return FindTopDocuments<RankingPolicy>(raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename RankingPolicy, typename DocumentPredicate>
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                                               size_t max_result_document_count) const {
+    const auto query = ParseQuery(raw_query, stop_words_);
+    const Snapshot snapshot = TakeSnapshot();
+
+    // шарды блокируются по одному и только на время чтения вхождений слова
+    std::map<int, std::pair<double, const DocumentData*>> document_to_relevance;
+    std::vector<TermMatch> matches;
+    for (std::string_view word : query.plus_words) {
+        matches.clear();
+        const int document_freq = CollectTermMatches(word, snapshot, document_predicate, matches);
+        if (document_freq == 0) {
+            continue;
+        }
+        const double inverse_document_freq = RankingPolicy::ComputeInverseDocumentFreq(snapshot.document_count, document_freq);
+        for (const TermMatch& match : matches) {
+            const DocumentData& document_data = *match.document_data;
+            if (!document_predicate(match.document_id, document_data.status, document_data.rating)) {
+                continue;
+            }
+            auto& [relevance, data] = document_to_relevance[match.document_id];
+            relevance += RankingPolicy::ComputeTermRelevance(match.term_freq, document_data.word_count,
+                                                             snapshot.average_document_length, inverse_document_freq);
+            data = &document_data;
+        }
+    }
+
+    for (std::string_view word : query.minus_words) {
+        matches.clear();
+        CollectTermMatches(word, snapshot, [](int, DocumentStatus, int) { return true; }, matches);
+        for (const TermMatch& match : matches) {
+            document_to_relevance.erase(match.document_id);
+        }
+    }
+
+    std::vector<Document> matched_documents;
+    matched_documents.reserve(document_to_relevance.size());
+    for (const auto& [document_id, relevance_and_data] : document_to_relevance) {
+        matched_documents.push_back({document_id, relevance_and_data.first, relevance_and_data.second->rating});
+    }
+    SelectTopDocuments(matched_documents, max_result_document_count);
+    return matched_documents;
+}
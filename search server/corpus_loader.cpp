@@ -0,0 +1,126 @@
+#include "corpus_loader.h"
+
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <execution>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+std::string_view CutField(std::string_view& line, size_t line_number) {
+    const size_t tab = line.find('\t');
+    if (tab == std::string_view::npos) {
+        throw std::invalid_argument("Corpus line " + std::to_string(line_number) + " has too few fields");
+    }
+    const std::string_view field = line.substr(0, tab);
+    line.remove_prefix(tab + 1);
+    return field;
+}
+
+int ParseInt(std::string_view text, size_t line_number) {
+    int value = 0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc() || end != text.data() + text.size()) {
+        throw std::invalid_argument("Corpus line " + std::to_string(line_number) + " has invalid number");
+    }
+    return value;
+}
+
+RawDocument ParseCorpusLine(std::string_view line, size_t line_number) {
+    RawDocument document;
+    document.id = ParseInt(CutField(line, line_number), line_number);
+    const int status = ParseInt(CutField(line, line_number), line_number);
+    if (status < static_cast<int>(DocumentStatus::ACTUAL) || status > static_cast<int>(DocumentStatus::REMOVED)) {
+        throw std::invalid_argument("Corpus line " + std::to_string(line_number) + " has invalid status");
+    }
+    document.status = static_cast<DocumentStatus>(status);
+    for (std::string_view rating : SplitIntoWords(CutField(line, line_number))) {
+        document.ratings.push_back(ParseInt(rating, line_number));
+    }
+    document.text = line;
+    return document;
+}
+
+// Вызывает function(строка, номер строки) для каждой непустой строки файла
+template <typename Function>
+void ForEachCorpusLine(const MappedFile& file, Function function) {
+    const char* position = file.Data();
+    const char* const end = file.Data() + file.Size();
+    size_t line_number = 0;
+    while (position < end) {
+        const char* line_end = static_cast<const char*>(std::memchr(position, '\n', end - position));
+        if (line_end == nullptr) {
+            line_end = end;
+        }
+        std::string_view line(position, line_end - position);
+        position = line_end + (line_end < end ? 1 : 0);
+        ++line_number;
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (!line.empty()) {
+            function(line, line_number);
+        }
+    }
+}
+
+// Проверяет то, на чём споткнулся бы AddDocuments: id и управляющие символы в тексте
+void ValidateCorpus(const SearchServer& search_server, const MappedFile& file) {
+    std::vector<std::pair<int, size_t>> ids;
+    ForEachCorpusLine(file, [&ids](std::string_view line, size_t line_number) {
+        const RawDocument document = ParseCorpusLine(line, line_number);
+        if (document.id < 0) {
+            throw std::invalid_argument("Corpus line " + std::to_string(line_number) + " has invalid document id");
+        }
+        if (!IsValidWord(document.text)) {
+            throw std::invalid_argument("Corpus line " + std::to_string(line_number) + " has invalid word");
+        }
+        ids.emplace_back(document.id, line_number);
+    });
+    // повторы внутри файла и id, которые уже есть на сервере; id сервера перебираются по возрастанию
+    std::sort(ids.begin(), ids.end());
+    auto server_it = search_server.begin();
+    for (size_t i = 0; i < ids.size(); ++i) {
+        const auto [id, line_number] = ids[i];
+        while (server_it != search_server.end() && *server_it < id) {
+            ++server_it;
+        }
+        if ((i > 0 && ids[i - 1].first == id) || (server_it != search_server.end() && *server_it == id)) {
+            throw std::invalid_argument("Corpus line " + std::to_string(line_number) + " has duplicate document id");
+        }
+    }
+}
+
+}  // namespace
+
+size_t LoadCorpus(SearchServer& search_server, const std::string& path, size_t batch_size) {
+    if (batch_size == 0) {
+        throw std::invalid_argument("Batch size must be positive");
+    }
+    const MappedFile file(path);
+    // ошибка в любой строке обнаруживается до первой пачки, и сервер остаётся прежним
+    ValidateCorpus(search_server, file);
+
+    size_t document_count = 0;
+    std::vector<RawDocument> batch;
+    batch.reserve(batch_size);
+    ForEachCorpusLine(file, [&](std::string_view line, size_t line_number) {
+        batch.push_back(ParseCorpusLine(line, line_number));
+        if (batch.size() == batch_size) {
+            search_server.AddDocuments(std::execution::par, batch);
+            document_count += batch.size();
+            batch.clear();
+        }
+    });
+    if (!batch.empty()) {
+        search_server.AddDocuments(std::execution::par, batch);
+        document_count += batch.size();
+    }
+    return document_count;
+}
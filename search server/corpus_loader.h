@@ -0,0 +1,15 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <cstddef>
+#include <string>
+
+const size_t DEFAULT_CORPUS_BATCH_SIZE = 65536;
+
+// Загружает корпус из файла, по документу на строку: id<TAB>статус<TAB>рейтинги через пробел<TAB>текст.
+// Статус — число, как в DocumentStatus. Файл отображается в память и добавляется пачками
+// по batch_size документов через параллельный AddDocuments. Перед первой пачкой проверяется
+// весь файл: при ошибке в любой строке бросается invalid_argument и документы не добавляются.
+// Возвращает число добавленных документов.
+size_t LoadCorpus(SearchServer& search_server, const std::string& path, size_t batch_size = DEFAULT_CORPUS_BATCH_SIZE);
@@ -1,5 +1,7 @@
 #include "document.h"
 
+#include<algorithm>
+#include<cmath>
 #include<iostream>
 
 Document::Document() = default;
@@ -9,6 +11,10 @@ Document::Document(int id, double relevance, int rating)
     , rating(rating) {
 }
 
+bool DocumentFilter::operator()(int, DocumentStatus document_status, int rating) const {
+    return document_status == status && rating >= min_rating && rating <= max_rating;
+}
+
 void PrintDocument(const Document& document) {
     std::cout << "{ "
          << "document_id = " << document.id << ", "
@@ -23,3 +29,36 @@ std::ostream& operator<<(std::ostream& out, Document doc) {
          << "rating = " << doc.rating << " }";
     return out;
 }
+
+bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
+        if (lhs.rating == rhs.rating) {
+            return lhs.id < rhs.id;
+        }
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.relevance > rhs.relevance;
+}
+
+void SelectTopDocuments(std::vector<Document>& documents, size_t max_document_count) {
+    if (documents.size() > max_document_count) {
+        // полная сортировка не нужна: достаточно упорядочить первые K документов
+        const auto top_end = documents.begin() + max_document_count;
+        std::partial_sort(documents.begin(), top_end, documents.end(), IsMoreRelevant);
+        documents.erase(top_end, documents.end());
+    } else {
+        std::sort(documents.begin(), documents.end(), IsMoreRelevant);
+    }
+}
+
+int ComputeAverageRating(const std::vector<int>& ratings) {
+    if (ratings.empty()) {
+        return 0;
+    }
+    int rating_sum = 0;
+    for (const int rating : ratings) {
+        rating_sum += rating;
+    }
+    
+    return rating_sum / static_cast<int>(ratings.size());
+}
@@ -1,6 +1,12 @@
 #pragma once
 
+#include <cstddef>
+#include <limits>
 #include <ostream>
+#include <string_view>
+#include <vector>
+
+const double EPSILON = 1e-6;
 
 enum class DocumentStatus {
     ACTUAL,
@@ -9,6 +15,9 @@ enum class DocumentStatus {
     REMOVED,
 };
 
+// число значений DocumentStatus
+const size_t DOCUMENT_STATUS_COUNT = 4;
+
 struct Document {
     Document();
     Document(int id, double relevance, int rating);
@@ -17,6 +26,35 @@ struct Document {
     int rating = 0;
 };
 
+// Фильтр по статусу и диапазону рейтинга [min_rating, max_rating]. SearchServer просматривает только
+// участок списка вхождений с этим статусом и пропускает участок целиком, если рейтинги его документов
+// не попадают в диапазон; рейтинг отдельного документа сверяется с рейтингом во вхождении.
+struct DocumentFilter {
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    int min_rating = std::numeric_limits<int>::min();
+    int max_rating = std::numeric_limits<int>::max();
+
+    bool operator()(int document_id, DocumentStatus document_status, int rating) const;
+};
+
+// Документ для пакетного добавления; text должен жить до конца AddDocuments
+struct RawDocument {
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
 void PrintDocument(const Document& document);
 
+bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+
+// Оставляет max_document_count самых релевантных документов, упорядоченных по IsMoreRelevant.
+// Отбор всегда последовательный: IsMoreRelevant сравнивает релевантность с точностью EPSILON
+// и не задаёт строгого порядка, поэтому результат зависит от алгоритма сортировки и порядка
+// документов. Одинаковый порядок на входе даёт одинаковый результат для seq и par.
+void SelectTopDocuments(std::vector<Document>& documents, size_t max_document_count);
+
+int ComputeAverageRating(const std::vector<int>& ratings);
+
 std::ostream& operator<<(std::ostream& out, Document doc);
\ No newline at end of file
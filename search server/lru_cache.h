@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Потокобезопасный LRU-кэш значений по строковому ключу со счётчиками попаданий и промахов.
+// Общая часть PreparedQueryCache и QueryResultCache.
+template <typename Value>
+class LruCache {
+public:
+    explicit LruCache(size_t capacity);
+
+    // Значение по ключу; при промахе оно считается через compute() без блокировки и кладётся в кэш.
+    // Если compute() бросает исключение, в кэш ничего не попадает.
+    template <typename Compute>
+    Value GetOrCompute(std::string_view key, Compute compute);
+
+    // Значения, которые другие потоки считают в это время, в кэш уже не попадут:
+    // они могли быть посчитаны до изменения, из-за которого кэш сбрасывается.
+    void Clear();
+
+    size_t GetHitCount() const;
+    size_t GetMissCount() const;
+    size_t GetSize() const;
+
+private:
+    struct Entry {
+        std::string key;
+        Value value;
+    };
+
+    const size_t capacity_;
+    std::list<Entry> entries_;
+    // ключи ссылаются на key записей в entries_
+    std::unordered_map<std::string_view, typename std::list<Entry>::iterator> key_to_entry_;
+    // растёт при каждом Clear
+    uint64_t generation_ = 0;
+    size_t hit_count_ = 0;
+    size_t miss_count_ = 0;
+    mutable std::mutex mutex_;
+};
+
+template <typename Value>
+LruCache<Value>::LruCache(size_t capacity)
+    : capacity_(capacity) {
+    if (capacity_ == 0) {
+        throw std::invalid_argument("Cache capacity must be positive");
+    }
+}
+
+template <typename Value>
+template <typename Compute>
+Value LruCache<Value>::GetOrCompute(std::string_view key, Compute compute) {
+    uint64_t generation = 0;
+    {
+        std::lock_guard guard(mutex_);
+        if (const auto it = key_to_entry_.find(key); it != key_to_entry_.end()) {
+            ++hit_count_;
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return it->second->value;
+        }
+        ++miss_count_;
+        generation = generation_;
+    }
+    Value value = compute();
+    std::lock_guard guard(mutex_);
+    if (generation != generation_) {
+        return value;
+    }
+    // пока значение считалось, этот же ключ мог закэшировать другой поток
+    if (const auto it = key_to_entry_.find(key); it != key_to_entry_.end()) {
+        return it->second->value;
+    }
+    if (entries_.size() == capacity_) {
+        key_to_entry_.erase(entries_.back().key);
+        entries_.pop_back();
+    }
+    entries_.push_front({std::string(key), value});
+    key_to_entry_.emplace(entries_.front().key, entries_.begin());
+    return value;
+}
+
+template <typename Value>
+void LruCache<Value>::Clear() {
+    std::lock_guard guard(mutex_);
+    ++generation_;
+    key_to_entry_.clear();
+    entries_.clear();
+}
+
+template <typename Value>
+size_t LruCache<Value>::GetHitCount() const {
+    std::lock_guard guard(mutex_);
+    return hit_count_;
+}
+
+template <typename Value>
+size_t LruCache<Value>::GetMissCount() const {
+    std::lock_guard guard(mutex_);
+    return miss_count_;
+}
+
+template <typename Value>
+size_t LruCache<Value>::GetSize() const {
+    std::lock_guard guard(mutex_);
+    return entries_.size();
+}
@@ -27,7 +27,7 @@ int main() {
 
     request_queue.AddFindRequest("sparrow"s);
     std::cout << "Total empty requests: " << request_queue.GetNoResultRequests() << std::endl;
+    std::cout << "Request latency p50: " << request_queue.GetLatencyPercentile(50).count() << " us, p99: "
+              << request_queue.GetLatencyPercentile(99).count() << " us" << std::endl;
     return 0;
 }
-
-
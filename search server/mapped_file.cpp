@@ -0,0 +1,96 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path) {
+    file_handle_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_handle_ == INVALID_HANDLE_VALUE) {
+        file_handle_ = nullptr;
+        throw std::runtime_error("Cannot open file " + path);
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_handle_, &file_size)) {
+        CloseHandle(file_handle_);
+        throw std::runtime_error("Cannot get size of file " + path);
+    }
+    size_ = static_cast<size_t>(file_size.QuadPart);
+    if (size_ == 0) {
+        return;
+    }
+    mapping_handle_ = CreateFileMappingA(file_handle_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_handle_ == nullptr) {
+        CloseHandle(file_handle_);
+        throw std::runtime_error("Cannot map file " + path);
+    }
+    data_ = static_cast<const char*>(MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+    if (data_ == nullptr) {
+        CloseHandle(mapping_handle_);
+        CloseHandle(file_handle_);
+        throw std::runtime_error("Cannot map file " + path);
+    }
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_handle_ != nullptr) {
+        CloseHandle(mapping_handle_);
+    }
+    if (file_handle_ != nullptr) {
+        CloseHandle(file_handle_);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) {
+    const int file_descriptor = open(path.c_str(), O_RDONLY);
+    if (file_descriptor < 0) {
+        throw std::runtime_error("Cannot open file " + path);
+    }
+    struct stat file_stat;
+    if (fstat(file_descriptor, &file_stat) != 0) {
+        close(file_descriptor);
+        throw std::runtime_error("Cannot get size of file " + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    if (size_ == 0) {
+        close(file_descriptor);
+        return;
+    }
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, file_descriptor, 0);
+    // отображение остаётся действительным и после закрытия дескриптора
+    close(file_descriptor);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Cannot map file " + path);
+    }
+    data_ = static_cast<const char*>(data);
+}
+
+MappedFile::~MappedFile() {
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+#endif
+
+const char* MappedFile::Data() const {
+    return data_;
+}
+
+size_t MappedFile::Size() const {
+    return size_;
+}
@@ -1,12 +1,16 @@
 #pragma once
 
-#include<vector>
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <ostream>
+#include <stdexcept>
 
 template <typename Iterator>
 class IteratorRange {
 public:
 
-    IteratorRange(Iterator begin_iter,  Iterator end_iter) 
+    IteratorRange(Iterator begin_iter,  Iterator end_iter)
         : beg_(begin_iter)
         , end_(end_iter) {
     }
@@ -20,8 +24,8 @@ public:
     }
 
     auto size() const {
-        return distance(beg_, end_);
-    } 
+        return std::distance(beg_, end_);
+    }
 
 private:
     Iterator beg_;
@@ -34,41 +38,104 @@ std::ostream& operator<<(std::ostream& out, const IteratorRange<Iterator>& range
         out << *i;
     }
     return out;
-} 
+}
 
+// Страницы не хранятся, а вычисляются при обращении. Для итераторов произвольного доступа
+// Page(k) работает за O(1), для остальных — за время, пропорциональное смещению страницы.
 template <typename Iterator>
 class Paginator {
 public:
-    Paginator(Iterator range_begin, Iterator range_end, int page_size) {
-
-        for (int left = distance(range_begin, range_end); left > 0;) {
-            const size_t current_page_size = std::min(page_size, left);
-            const Iterator current_page_end = next(range_begin, current_page_size);
-            pages_.push_back({range_begin, current_page_end});
- 
-            left -= current_page_size;
-            range_begin = current_page_end;
+    // operator* строит страницу на лету и возвращает её по значению, поэтому итератор
+    // объявлен как input: forward-итератор обязан возвращать ссылку
+    class PageIterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = IteratorRange<Iterator>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = IteratorRange<Iterator>;
+
+        PageIterator(Iterator position, size_t left, size_t page_size)
+            : position_(position)
+            , left_(left)
+            , page_size_(page_size) {
+        }
+
+        IteratorRange<Iterator> operator*() const {
+            return {position_, std::next(position_, std::min(page_size_, left_))};
+        }
+
+        PageIterator& operator++() {
+            const size_t current_page_size = std::min(page_size_, left_);
+            position_ = std::next(position_, current_page_size);
+            left_ -= current_page_size;
+            return *this;
+        }
+
+        PageIterator operator++(int) {
+            PageIterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const PageIterator& other) const {
+            return left_ == other.left_;
+        }
+
+        bool operator!=(const PageIterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        Iterator position_;
+        size_t left_;
+        size_t page_size_;
+    };
+
+    Paginator(Iterator range_begin, Iterator range_end, size_t page_size)
+        : range_begin_(range_begin)
+        , range_end_(range_end)
+        , item_count_(std::distance(range_begin, range_end))
+        , page_size_(page_size) {
+        if (page_size_ == 0) {
+            throw std::invalid_argument("Page size must be positive");
         }
     }
 
-    auto begin() const {
-        return pages_.begin();
+    PageIterator begin() const {
+        return {range_begin_, item_count_, page_size_};
     }
- 
-    auto end() const {
-        return pages_.end();
+
+    PageIterator end() const {
+        return {range_end_, 0, page_size_};
     }
- 
+
     size_t size() const {
-        return pages_.size();
+        return (item_count_ + page_size_ - 1) / page_size_;
+    }
+
+    IteratorRange<Iterator> Page(size_t page_index) const {
+        if (page_index >= size()) {
+            throw std::out_of_range("Page index is out of range");
+        }
+        const size_t first = page_index * page_size_;
+        const Iterator page_begin = std::next(range_begin_, first);
+        return {page_begin, std::next(page_begin, std::min(page_size_, item_count_ - first))};
+    }
+
+    IteratorRange<Iterator> operator[](size_t page_index) const {
+        return Page(page_index);
     }
 
 private:
-    std::vector<IteratorRange<Iterator>> pages_;
+    Iterator range_begin_;
+    Iterator range_end_;
+    size_t item_count_;
+    size_t page_size_;
 };
 
 
 template <typename ContainerType>
 auto Paginate(const ContainerType& documents, size_t page_size) {
     return Paginator(begin(documents), end(documents), page_size);
-};
\ No newline at end of file
+};
@@ -0,0 +1,25 @@
+#include "prepared_query_cache.h"
+
+PreparedQueryCache::PreparedQueryCache(const SearchServer& search_server, size_t capacity)
+    : search_server_(search_server)
+    , cache_(capacity) {
+}
+
+std::shared_ptr<const SearchServer::PreparedQuery> PreparedQueryCache::Get(std::string_view raw_query) {
+    // ParseQuery бросает invalid_argument до вставки в кэш
+    return cache_.GetOrCompute(raw_query, [&] {
+        return std::make_shared<const SearchServer::PreparedQuery>(search_server_.PrepareQuery(raw_query));
+    });
+}
+
+size_t PreparedQueryCache::GetHitCount() const {
+    return cache_.GetHitCount();
+}
+
+size_t PreparedQueryCache::GetMissCount() const {
+    return cache_.GetMissCount();
+}
+
+size_t PreparedQueryCache::GetSize() const {
+    return cache_.GetSize();
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "lru_cache.h"
+#include "search_server.h"
+
+#include <memory>
+#include <string_view>
+
+const size_t DEFAULT_PREPARED_QUERY_CACHE_CAPACITY = 1024;
+
+// LRU-кэш разобранных запросов: повторяющаяся строка запроса разбирается один раз.
+// Слова, которых не было в словаре при разборе, сервер досматривает при каждом поиске,
+// поэтому закэшированный запрос не устаревает при добавлении документов.
+class PreparedQueryCache {
+public:
+    explicit PreparedQueryCache(const SearchServer& search_server, size_t capacity = DEFAULT_PREPARED_QUERY_CACHE_CAPACITY);
+
+    std::shared_ptr<const SearchServer::PreparedQuery> Get(std::string_view raw_query);
+
+    size_t GetHitCount() const;
+    size_t GetMissCount() const;
+    size_t GetSize() const;
+
+private:
+    const SearchServer& search_server_;
+    LruCache<std::shared_ptr<const SearchServer::PreparedQuery>> cache_;
+};
@@ -0,0 +1,39 @@
+#include "process_queries.h"
+
+#include <algorithm>
+#include <execution>
+#include <numeric>
+
+std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries) {
+    std::vector<std::vector<Document>> documents_lists(queries.size());
+    std::transform(std::execution::par, queries.begin(), queries.end(), documents_lists.begin(),
+        [&search_server](const std::string& query) {
+            return search_server.FindTopDocuments(query);
+        });
+    return documents_lists;
+}
+
+std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries) {
+    // каждый запрос пишет свой топ в собственный слот общего буфера, после чего слоты сдвигаются встык
+    const size_t slot_size = std::min<size_t>(search_server.GetMaxResultDocumentCount(), search_server.GetDocumentCount());
+    std::vector<Document> documents(queries.size() * slot_size);
+    std::vector<size_t> documents_counts(queries.size());
+    std::vector<size_t> query_indexes(queries.size());
+    std::iota(query_indexes.begin(), query_indexes.end(), 0);
+
+    std::for_each(std::execution::par, query_indexes.begin(), query_indexes.end(),
+        [&](size_t index) {
+            const auto top_documents = search_server.FindTopDocuments(queries[index]);
+            std::copy(top_documents.begin(), top_documents.end(), documents.begin() + index * slot_size);
+            documents_counts[index] = top_documents.size();
+        });
+
+    size_t joined_size = 0;
+    for (size_t index = 0; index < queries.size(); ++index) {
+        const auto slot_begin = documents.begin() + index * slot_size;
+        std::move(slot_begin, slot_begin + documents_counts[index], documents.begin() + joined_size);
+        joined_size += documents_counts[index];
+    }
+    documents.resize(joined_size);
+    return documents;
+}
@@ -0,0 +1,75 @@
+#include "query_result_cache.h"
+
+QueryResultCache::QueryResultCache(SearchServer& search_server, size_t capacity)
+    : search_server_(search_server)
+    , cache_(capacity) {
+}
+
+std::vector<Document> QueryResultCache::FindTopDocuments(std::string_view raw_query, DocumentStatus status) {
+    const std::string predicate_key = "status:" + std::to_string(static_cast<int>(status));
+    return FindTopDocumentsByKey(raw_query, predicate_key, DocumentFilter{status});
+}
+
+std::vector<Document> QueryResultCache::FindTopDocuments(std::string_view raw_query) {
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+void QueryResultCache::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
+    search_server_.AddDocument(document_id, document, status, ratings);
+    cache_.Clear();
+}
+
+void QueryResultCache::RemoveDocument(int document_id) {
+    const int document_count = search_server_.GetDocumentCount();
+    search_server_.RemoveDocument(document_id);
+    // кэш сбрасывается после удаления: иначе поиск, начатый между сбросом и удалением,
+    // положил бы в кэш результат с удалённым документом
+    if (search_server_.GetDocumentCount() != document_count) {
+        cache_.Clear();
+    }
+}
+
+size_t QueryResultCache::GetHitCount() const {
+    return cache_.GetHitCount();
+}
+
+size_t QueryResultCache::GetMissCount() const {
+    return cache_.GetMissCount();
+}
+
+size_t QueryResultCache::GetSize() const {
+    return cache_.GetSize();
+}
+
+namespace {
+
+// Длина перед каждой частью делает ключ однозначным при любых символах в словах и тегах
+void AppendKeyPart(std::string& key, std::string_view part) {
+    key += std::to_string(part.size());
+    key += ':';
+    key += part;
+}
+
+}  // namespace
+
+std::string QueryResultCache::MakeKey(const SearchServer::PreparedQuery& query, std::string_view predicate_key) const {
+    std::string key;
+    for (const auto* word_ids : {&query.plus_words, &query.minus_words}) {
+        key += std::to_string(word_ids->size());
+        key += ';';
+        for (const SearchServer::WordId word_id : *word_ids) {
+            key += std::to_string(word_id);
+            key += ';';
+        }
+    }
+    for (const auto* words : {&query.unknown_plus_words, &query.unknown_minus_words}) {
+        key += std::to_string(words->size());
+        key += ';';
+        for (const std::string& word : *words) {
+            AppendKeyPart(key, word);
+        }
+    }
+    AppendKeyPart(key, predicate_key);
+    key += std::to_string(search_server_.GetMaxResultDocumentCount());
+    return key;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "document.h"
+#include "lru_cache.h"
+#include "search_server.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+const size_t DEFAULT_QUERY_CACHE_CAPACITY = 1024;
+
+// LRU-кэш результатов FindTopDocuments. Запрос разбирается один раз через PrepareQuery,
+// ключ — id его плюс- и минус-слов и слова, которых нет в словаре, тег фильтра и число
+// результатов. Каждая часть ключа записывается с длиной, поэтому разные запросы не
+// склеиваются в один ключ, а теги пользовательских предикатов не пересекаются с фильтрами
+// по статусу.
+// Документы нужно добавлять и удалять через кэш, и каждое изменение сбрасывает его целиком:
+// IDF каждого слова зависит от числа документов, поэтому после него меняется релевантность,
+// а с ней и состав первых результатов, любого запроса, а не только запросов со словами
+// изменённого документа. Кэш полезен, пока индекс только читается.
+class QueryResultCache {
+public:
+    explicit QueryResultCache(SearchServer& search_server, size_t capacity = DEFAULT_QUERY_CACHE_CAPACITY);
+
+    // predicate_tag должен однозначно определять document_predicate
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, std::string_view predicate_tag, DocumentPredicate document_predicate);
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status);
+    std::vector<Document> FindTopDocuments(std::string_view raw_query);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+
+    size_t GetHitCount() const;
+    size_t GetMissCount() const;
+    size_t GetSize() const;
+
+private:
+    SearchServer& search_server_;
+    LruCache<std::vector<Document>> cache_;
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsByKey(std::string_view raw_query, std::string_view predicate_key, DocumentPredicate document_predicate);
+
+    std::string MakeKey(const SearchServer::PreparedQuery& query, std::string_view predicate_key) const;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> QueryResultCache::FindTopDocuments(std::string_view raw_query, std::string_view predicate_tag, DocumentPredicate document_predicate) {
+    return FindTopDocumentsByKey(raw_query, "predicate:" + std::string(predicate_tag), document_predicate);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> QueryResultCache::FindTopDocumentsByKey(std::string_view raw_query, std::string_view predicate_key, DocumentPredicate document_predicate) {
+    const auto query = search_server_.PrepareQuery(raw_query);
+    return cache_.GetOrCompute(MakeKey(query, predicate_key), [&] {
+        return search_server_.FindTopDocuments(query, document_predicate);
+    });
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cmath>
+
+// Политики ранжирования для FindTopDocuments. Политика — тип со статическими функциями
+// ComputeInverseDocumentFreq и ComputeTermRelevance; вызовы подставляются на этапе компиляции.
+// term_freq — доля слова среди слов документа, document_length — число слов документа без стоп-слов.
+// SearchServer кэширует IDF отдельно для каждой ComputeInverseDocumentFreq, поэтому её результат
+// должен зависеть только от аргументов.
+
+struct TfIdfRanking {
+    static double ComputeInverseDocumentFreq(int document_count, int document_freq) {
+        return std::log(document_count * 1.0 / document_freq);
+    }
+
+    static double ComputeTermRelevance(double term_freq, int, double, double inverse_document_freq) {
+        return term_freq * inverse_document_freq;
+    }
+};
+
+struct Bm25Ranking {
+    static constexpr double K1 = 1.2;
+    static constexpr double B = 0.75;
+
+    static double ComputeInverseDocumentFreq(int document_count, int document_freq) {
+        return std::log((document_count - document_freq + 0.5) / (document_freq + 0.5) + 1.0);
+    }
+
+    static double ComputeTermRelevance(double term_freq, int document_length, double average_document_length, double inverse_document_freq) {
+        const double term_count = term_freq * document_length;
+        const double length_norm = 1.0 - B + B * document_length / average_document_length;
+        return inverse_document_freq * term_count * (K1 + 1.0) / (term_count + K1 * length_norm);
+    }
+};
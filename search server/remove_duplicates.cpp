@@ -0,0 +1,51 @@
+#include "remove_duplicates.h"
+
+#include <algorithm>
+#include <execution>
+#include <functional>
+#include <unordered_map>
+
+namespace {
+
+using WordFrequencies = std::vector<std::pair<SearchServer::WordId, double>>;
+
+// слова отсортированы по id и без повторов, поэтому одинаковые наборы слов дают одинаковый хэш
+size_t ComputeWordSetHash(const WordFrequencies& word_freqs) {
+    size_t hash = word_freqs.size();
+    for (const auto& [word_id, _] : word_freqs) {
+        hash = hash * 37 + std::hash<SearchServer::WordId>{}(word_id);
+    }
+    return hash;
+}
+
+// частоты не сравниваются: дубликатом считается документ с тем же набором слов
+bool HaveSameWords(const WordFrequencies& lhs, const WordFrequencies& rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+        [](const auto& lhs_word, const auto& rhs_word) {
+            return lhs_word.first == rhs_word.first;
+        });
+}
+
+}  // namespace
+
+std::vector<int> RemoveDuplicates(SearchServer& search_server) {
+    // документы перебираются по возрастанию id, поэтому из группы дубликатов остаётся документ с наименьшим id
+    std::unordered_map<size_t, std::vector<int>> hash_to_document_ids;
+    std::vector<int> duplicate_ids;
+    for (const int document_id : search_server) {
+        const auto& word_freqs = search_server.GetWordIdFrequencies(document_id);
+        auto& same_hash_ids = hash_to_document_ids[ComputeWordSetHash(word_freqs)];
+        const bool is_duplicate = std::any_of(same_hash_ids.begin(), same_hash_ids.end(),
+            [&search_server, &word_freqs](int original_id) {
+                return HaveSameWords(search_server.GetWordIdFrequencies(original_id), word_freqs);
+            });
+        if (is_duplicate) {
+            duplicate_ids.push_back(document_id);
+        } else {
+            same_hash_ids.push_back(document_id);
+        }
+    }
+
+    search_server.RemoveDocuments(std::execution::seq, duplicate_ids);
+    return duplicate_ids;
+}
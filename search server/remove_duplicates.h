@@ -0,0 +1,8 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <vector>
+
+// Удаляет документы с тем же набором слов, что у документа с меньшим id, и возвращает их id
+std::vector<int> RemoveDuplicates(SearchServer& search_server);
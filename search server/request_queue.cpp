@@ -1,19 +1,59 @@
 #include "request_queue.h"
 
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
 RequestQueue::RequestQueue(const SearchServer& search_server) 
     : search_server_(search_server) {   
 }
 
-std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
-    return AddFindRequest(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-        return document_status == status;
-    });
+std::vector<Document> RequestQueue::AddFindRequest(std::string_view raw_query, DocumentStatus status) {
+    return AddFindRequest(raw_query, DocumentFilter{status});
 }
 
-std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
+std::vector<Document> RequestQueue::AddFindRequest(std::string_view raw_query) {
     return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
 }
 
 int RequestQueue::GetNoResultRequests() const {
+    std::lock_guard guard(mutex_);
     return number_of_empty_requests;
 }
+
+std::chrono::microseconds RequestQueue::GetLatencyPercentile(double percentile) const {
+    if (percentile < 0.0 || percentile > 100.0) {
+        throw std::invalid_argument("Percentile must be in range [0, 100]");
+    }
+    std::vector<std::chrono::microseconds> latencies;
+    {
+        std::lock_guard guard(mutex_);
+        latencies.reserve(request_count_);
+        for (size_t i = 0; i < request_count_; ++i) {
+            latencies.push_back(requests_[i].latency);
+        }
+    }
+    if (latencies.empty()) {
+        return std::chrono::microseconds{0};
+    }
+    // метод ближайшего ранга
+    const size_t rank = std::max<size_t>(1, static_cast<size_t>(std::ceil(percentile / 100.0 * latencies.size())));
+    const auto nth = latencies.begin() + (rank - 1);
+    std::nth_element(latencies.begin(), nth, latencies.end());
+    return *nth;
+}
+
+void RequestQueue::AddRequestStats(size_t result_count, std::chrono::microseconds latency) {
+    std::lock_guard guard(mutex_);
+    RequestStats& slot = requests_[next_request_index_];
+    // окно заполнено: новая запись вытесняет самую старую
+    if (request_count_ == min_in_day_ && slot.result_count == 0) {
+        --number_of_empty_requests;
+    }
+    slot = {static_cast<uint32_t>(result_count), latency};
+    if (result_count == 0) {
+        ++number_of_empty_requests;
+    }
+    next_request_index_ = (next_request_index_ + 1) % min_in_day_;
+    request_count_ = std::min<size_t>(request_count_ + 1, min_in_day_);
+}
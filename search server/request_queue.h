@@ -2,42 +2,47 @@
 #include "document.h"
 #include "search_server.h"
 
-#include <deque>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
 #include <vector>
 
+// Статистика по последним min_in_day_ запросам. Окно хранится в кольцевом буфере
+// компактных записей, методы можно вызывать из нескольких потоков.
 class RequestQueue {
 public:
     template <typename DocumentPredicate>
-    std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
+    std::vector<Document> AddFindRequest(std::string_view raw_query, DocumentPredicate document_predicate);
     
     explicit RequestQueue(const SearchServer& search_server);
-    std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
-    std::vector<Document> AddFindRequest(const std::string& raw_query);
+    std::vector<Document> AddFindRequest(std::string_view raw_query, DocumentStatus status);
+    std::vector<Document> AddFindRequest(std::string_view raw_query);
     int GetNoResultRequests() const;
+    // percentile задаётся в процентах, от 0 до 100
+    std::chrono::microseconds GetLatencyPercentile(double percentile) const;
     
 private:
-    struct QueryResult {
-        std::vector<Document> result;
+    struct RequestStats {
+        uint32_t result_count;
+        std::chrono::microseconds latency;
     };
-    
-    std::deque<QueryResult> requests_;
+
     const SearchServer& search_server_;
     const static int min_in_day_ = 1440;
+    std::array<RequestStats, min_in_day_> requests_;
+    size_t next_request_index_ = 0;
+    size_t request_count_ = 0;
     int number_of_empty_requests = 0;
+    mutable std::mutex mutex_;
+
+    void AddRequestStats(size_t result_count, std::chrono::microseconds latency);
 };
 
 template <typename DocumentPredicate>
-std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
+std::vector<Document> RequestQueue::AddFindRequest(std::string_view raw_query, DocumentPredicate document_predicate) {
+    const auto start_time = std::chrono::steady_clock::now();
     auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
-    if (requests_.size() >= min_in_day_) {
-        if (requests_[0].result.size() != 0) {
-            --number_of_empty_requests;
-            requests_.pop_back();  
-        }
-    }
-    if (result.empty()) {
-        ++number_of_empty_requests;
-    }
-    requests_.push_front({result});
+    AddRequestStats(result.size(), std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time));
     return result;
-}
\ No newline at end of file
+}
@@ -0,0 +1,138 @@
+#include "search_metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+QueryMetrics& QueryMetrics::operator+=(const QueryMetrics& other) {
+    postings_scanned += other.postings_scanned;
+    documents_matched += other.documents_matched;
+    minus_word_removals += other.minus_word_removals;
+    parse_time += other.parse_time;
+    score_time += other.score_time;
+    sort_time += other.sort_time;
+    return *this;
+}
+
+namespace {
+
+// отдельная кэш-линия, чтобы потоки не мешали друг другу
+struct alignas(64) ThreadCounters {
+    std::atomic<uint64_t> query_count{0};
+    std::atomic<uint64_t> postings_scanned{0};
+    std::atomic<uint64_t> documents_matched{0};
+    std::atomic<uint64_t> minus_word_removals{0};
+    std::atomic<int64_t> parse_nanoseconds{0};
+    std::atomic<int64_t> score_nanoseconds{0};
+    std::atomic<int64_t> sort_nanoseconds{0};
+
+    SearchMetrics Load() const {
+        SearchMetrics metrics;
+        metrics.query_count = query_count.load(std::memory_order_relaxed);
+        metrics.total.postings_scanned = postings_scanned.load(std::memory_order_relaxed);
+        metrics.total.documents_matched = documents_matched.load(std::memory_order_relaxed);
+        metrics.total.minus_word_removals = minus_word_removals.load(std::memory_order_relaxed);
+        metrics.total.parse_time = std::chrono::nanoseconds(parse_nanoseconds.load(std::memory_order_relaxed));
+        metrics.total.score_time = std::chrono::nanoseconds(score_nanoseconds.load(std::memory_order_relaxed));
+        metrics.total.sort_time = std::chrono::nanoseconds(sort_nanoseconds.load(std::memory_order_relaxed));
+        return metrics;
+    }
+
+    void Reset() {
+        for (auto* counter : {&query_count, &postings_scanned, &documents_matched, &minus_word_removals}) {
+            counter->store(0, std::memory_order_relaxed);
+        }
+        for (auto* counter : {&parse_nanoseconds, &score_nanoseconds, &sort_nanoseconds}) {
+            counter->store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+struct MetricsRegistry {
+    std::mutex mutex;
+    std::vector<ThreadCounters*> threads;
+    // итоги завершившихся потоков
+    SearchMetrics retired;
+};
+
+MetricsRegistry& GetMetricsRegistry() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+class ThreadCountersRegistration {
+public:
+    ThreadCountersRegistration() {
+        auto& registry = GetMetricsRegistry();
+        std::lock_guard guard(registry.mutex);
+        registry.threads.push_back(&counters_);
+    }
+
+    ~ThreadCountersRegistration() {
+        auto& registry = GetMetricsRegistry();
+        std::lock_guard guard(registry.mutex);
+        const SearchMetrics metrics = counters_.Load();
+        registry.retired.query_count += metrics.query_count;
+        registry.retired.total += metrics.total;
+        registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), &counters_));
+    }
+
+    ThreadCounters& GetCounters() {
+        return counters_;
+    }
+
+private:
+    ThreadCounters counters_;
+};
+
+ThreadCounters& GetThreadCounters() {
+    thread_local ThreadCountersRegistration registration;
+    return registration.GetCounters();
+}
+
+thread_local QueryMetrics last_query_metrics;
+
+}  // namespace
+
+void RecordQueryMetrics(const QueryMetrics& metrics) {
+    if constexpr (!SEARCH_METRICS_ENABLED) {
+        return;
+    }
+    last_query_metrics = metrics;
+    // поток-владелец — единственный писатель, fetch_add не конкурирует за кэш-линию
+    auto& counters = GetThreadCounters();
+    counters.query_count.fetch_add(1, std::memory_order_relaxed);
+    counters.postings_scanned.fetch_add(metrics.postings_scanned, std::memory_order_relaxed);
+    counters.documents_matched.fetch_add(metrics.documents_matched, std::memory_order_relaxed);
+    counters.minus_word_removals.fetch_add(metrics.minus_word_removals, std::memory_order_relaxed);
+    counters.parse_nanoseconds.fetch_add(metrics.parse_time.count(), std::memory_order_relaxed);
+    counters.score_nanoseconds.fetch_add(metrics.score_time.count(), std::memory_order_relaxed);
+    counters.sort_nanoseconds.fetch_add(metrics.sort_time.count(), std::memory_order_relaxed);
+}
+
+QueryMetrics GetLastQueryMetrics() {
+    return last_query_metrics;
+}
+
+SearchMetrics CollectSearchMetrics() {
+    auto& registry = GetMetricsRegistry();
+    std::lock_guard guard(registry.mutex);
+    SearchMetrics result = registry.retired;
+    for (const ThreadCounters* counters : registry.threads) {
+        const SearchMetrics metrics = counters->Load();
+        result.query_count += metrics.query_count;
+        result.total += metrics.total;
+    }
+    return result;
+}
+
+void ResetSearchMetrics() {
+    auto& registry = GetMetricsRegistry();
+    std::lock_guard guard(registry.mutex);
+    registry.retired = {};
+    for (ThreadCounters* counters : registry.threads) {
+        // сбрасывать счётчики чужого потока безопасно: он пишет только через fetch_add
+        counters->Reset();
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// Счётчики поиска включаются макросом SEARCH_SERVER_METRICS (-DSEARCH_SERVER_METRICS),
+// который должен быть одинаковым для всех единиц трансляции. Без него замеры
+// вырезаются на этапе компиляции, а функции ниже возвращают нули.
+#ifdef SEARCH_SERVER_METRICS
+inline constexpr bool SEARCH_METRICS_ENABLED = true;
+#else
+inline constexpr bool SEARCH_METRICS_ENABLED = false;
+#endif
+
+// Метрики одного запроса FindTopDocuments / FindTopDocumentsWithAllWords
+struct QueryMetrics {
+    uint64_t postings_scanned = 0;
+    uint64_t documents_matched = 0;
+    // документы, подошедшие по плюс-словам и отброшенные минус-словами
+    uint64_t minus_word_removals = 0;
+    std::chrono::nanoseconds parse_time{0};
+    std::chrono::nanoseconds score_time{0};
+    std::chrono::nanoseconds sort_time{0};
+
+    QueryMetrics& operator+=(const QueryMetrics& other);
+};
+
+struct SearchMetrics {
+    uint64_t query_count = 0;
+    QueryMetrics total;
+};
+
+// Прибавляет время жизни объекта к duration. В сборке без метрик ничего не делает.
+class MetricsPhaseTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit MetricsPhaseTimer([[maybe_unused]] std::chrono::nanoseconds& duration) {
+        if constexpr (SEARCH_METRICS_ENABLED) {
+            duration_ = &duration;
+            start_time_ = Clock::now();
+        }
+    }
+
+    ~MetricsPhaseTimer() {
+        if constexpr (SEARCH_METRICS_ENABLED) {
+            *duration_ += Clock::now() - start_time_;
+        }
+    }
+
+    MetricsPhaseTimer(const MetricsPhaseTimer&) = delete;
+    MetricsPhaseTimer& operator=(const MetricsPhaseTimer&) = delete;
+
+private:
+    std::chrono::nanoseconds* duration_ = nullptr;
+    Clock::time_point start_time_;
+};
+
+// Счётчики каждого потока пишутся только им самим, без блокировок;
+// блокировка берётся при первом запросе потока, при его завершении и при чтении сводки.
+void RecordQueryMetrics(const QueryMetrics& metrics);
+
+// Метрики последнего запроса, выполненного вызывающим потоком
+QueryMetrics GetLastQueryMetrics();
+
+// Сумма по всем потокам, в том числе уже завершившимся
+SearchMetrics CollectSearchMetrics();
+
+void ResetSearchMetrics();
@@ -1,33 +1,360 @@
 #include "search_server.h"
+#include "mapped_file.h"
 
+#include <cstring>
+#include <fstream>
 
-SearchServer::SearchServer(const std::string& stop_words_text)
-        : SearchServer(SplitIntoWords(stop_words_text)) {
+namespace {
+
+// Снимок индекса: заголовок, затем секции, выровненные на 8 байт, в порядке
+// стоп-слова, словарь, смещения списков вхождений, вхождения, документы.
+// Числа записываются в порядке байт текущей платформы.
+const char INDEX_FILE_MAGIC[8] = {'S', 'R', 'C', 'H', 'I', 'D', 'X', '\0'};
+const uint32_t INDEX_FILE_VERSION = 2;
+
+struct IndexFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t posting_size;
+    uint64_t stop_word_count;
+    uint64_t word_count;
+    uint64_t posting_count;
+    uint64_t document_count;
+};
+
+struct IndexFilePosting {
+    int32_t document_id;
+    int32_t reserved;
+    double term_freq;
+};
+
+struct IndexFileDocument {
+    int32_t document_id;
+    int32_t rating;
+    int32_t status;
+    int32_t word_count;
+};
+
+template <typename T>
+void WriteArray(std::ostream& out, const T* values, size_t count) {
+    out.write(reinterpret_cast<const char*>(values), sizeof(T) * count);
+}
+
+void WritePadding(std::ostream& out, size_t written_size) {
+    static const char zeros[8] = {};
+    out.write(zeros, (8 - written_size % 8) % 8);
 }
 
-void SearchServer::AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings) {
+template <typename StringRange>
+void WriteStrings(std::ostream& out, const StringRange& strings) {
+    std::vector<uint64_t> offsets = {0};
+    for (std::string_view str : strings) {
+        offsets.push_back(offsets.back() + str.size());
+    }
+    WriteArray(out, offsets.data(), offsets.size());
+    for (std::string_view str : strings) {
+        out.write(str.data(), str.size());
+    }
+    WritePadding(out, offsets.back());
+}
+
+class IndexFileReader {
+public:
+    IndexFileReader(const char* data, size_t size)
+        : data_(data)
+        , size_(size) {
+    }
+
+    template <typename T>
+    const T* ReadArray(uint64_t count) {
+        if (count > GetRemainingSize() / sizeof(T)) {
+            throw std::runtime_error("Index file is truncated");
+        }
+        const T* values = reinterpret_cast<const T*>(data_ + position_);
+        position_ += sizeof(T) * count;
+        return values;
+    }
+
+    size_t GetRemainingSize() const {
+        return size_ - position_;
+    }
+
+    // Таблица смещений из count + 1 элемента; count проверяется до сложения, чтобы оно не переполнилось
+    const uint64_t* ReadOffsets(uint64_t count) {
+        if (count >= GetRemainingSize() / sizeof(uint64_t)) {
+            throw std::runtime_error("Index file is truncated");
+        }
+        return ReadArray<uint64_t>(count + 1);
+    }
+
+    std::vector<std::string_view> ReadStrings(uint64_t count) {
+        const uint64_t* offsets = ReadOffsets(count);
+        const char* chars = ReadArray<char>(offsets[count]);
+        std::vector<std::string_view> strings;
+        strings.reserve(count);
+        for (uint64_t i = 0; i < count; ++i) {
+            if (offsets[i] > offsets[i + 1] || offsets[i + 1] > offsets[count]) {
+                throw std::runtime_error("Index file is corrupted");
+            }
+            strings.emplace_back(chars + offsets[i], offsets[i + 1] - offsets[i]);
+        }
+        ReadArray<char>((8 - offsets[count] % 8) % 8);
+        return strings;
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t position_ = 0;
+};
+
+}  // namespace
+
+
+SearchServer::SearchServer(const std::string& stop_words_text, size_t max_result_document_count)
+        : SearchServer(std::string_view(stop_words_text), max_result_document_count) {
+}
+
+SearchServer::SearchServer(std::string_view stop_words_text, size_t max_result_document_count)
+        : SearchServer(SplitIntoWords(stop_words_text), max_result_document_count) {
+}
+
+void SearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings) {
     if ((document_id < 0) || (documents_.count(document_id) > 0)) {
         throw std::invalid_argument("Invalid document_id");
     }
     
-    const auto words = SplitIntoWordsNoStop(document);
-    const double inv_word_count = 1.0 / words.size();
-    
-    for (const std::string& word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
+    const auto words = SplitIntoValidWords(document);
+    DecompressPostings();
+
+    // стоп-слова тоже лежат в словаре, поэтому один поиск по словарю заменяет и проверку на стоп-слово
+    std::vector<WordId> token_ids;
+    token_ids.reserve(words.size());
+    for (std::string_view word : words) {
+        const WordId word_id = GetOrAddWordId(word);
+        if (!is_stop_word_[word_id]) {
+            token_ids.push_back(word_id);
+        }
+    }
+    std::sort(token_ids.begin(), token_ids.end());
+    DocumentData document_data{ComputeAverageRating(ratings), status, static_cast<int>(token_ids.size()), {}};
+    for (auto it = token_ids.begin(); it != token_ids.end();) {
+        const WordId word_id = *it;
+        const auto word_end = std::upper_bound(it, token_ids.end(), word_id);
+        const double term_freq = (word_end - it) / static_cast<double>(token_ids.size());
+        it = word_end;
+        document_data.word_freqs.emplace_back(word_id, term_freq);
+        auto& postings = word_postings_[word_id][static_cast<size_t>(status)];
+        if (postings.empty() || postings.back().document_id < document_id) {
+            postings.push_back({document_id, document_data.rating, term_freq});
+        } else {
+            const auto position = std::lower_bound(postings.begin(), postings.end(), document_id,
+                [](const Posting& posting, int id) {
+                    return posting.document_id < id;
+                });
+            postings.insert(position, {document_id, document_data.rating, term_freq});
+        }
+        rating_ranges_[word_id][static_cast<size_t>(status)].Add(document_data.rating);
+        InvalidateInverseDocumentFreq(word_id);
     }
-    documents_.emplace(document_id, DocumentData{ComputeAverageRating(ratings), status});
-    document_ids_.push_back(document_id);
+    total_word_count_ += document_data.word_count;
+    documents_.emplace(document_id, std::move(document_data));
+    UpdateDocumentLookup(document_id);
+    document_ids_.insert(document_id);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query, DocumentStatus status) const {
-    return FindTopDocuments(raw_query, [status](int document_id, DocumentStatus document_status, int rating) {
-                return document_status == status;
-    });
+void SearchServer::AddDocuments(const std::vector<RawDocument>& documents) {
+    AddDocuments(std::execution::seq, documents);
+}
+
+void SearchServer::PrecomputeInverseDocumentFreqs() {
+    // IDF заполняются для политики по умолчанию и для всех политик, с которыми уже искали
+    GetInverseDocumentFreqCache(&TfIdfRanking::ComputeInverseDocumentFreq);
+    for (const auto& cache : idf_caches_) {
+        for (WordId word_id = 0; word_id < word_postings_.size(); ++word_id) {
+            if (GetPostingCount(word_id) > 0) {
+                ComputeWordInverseDocumentFreq(word_id, cache);
+            }
+        }
+    }
+}
+
+void SearchServer::CompressPostings() {
+    if (postings_compressed_) {
+        return;
+    }
+    compressed_postings_.clear();
+    compressed_postings_.resize(word_postings_.size());
+    std::vector<std::pair<int, int>> term_counts;
+    for (WordId word_id = 0; word_id < word_postings_.size(); ++word_id) {
+        for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+            auto& postings = word_postings_[word_id][status];
+            term_counts.clear();
+            for (const auto& [document_id, _, term_freq] : postings) {
+                const int word_count = GetDocumentData(document_id).word_count;
+                term_counts.emplace_back(document_id, static_cast<int>(std::lround(term_freq * word_count)));
+            }
+            compressed_postings_[word_id][status] = CompressedPostingList(term_counts);
+            std::vector<Posting>().swap(postings);
+        }
+    }
+    postings_compressed_ = true;
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query) const {
-    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+bool SearchServer::ArePostingsCompressed() const {
+    return postings_compressed_;
+}
+
+size_t SearchServer::GetPostingsMemoryUsage() const {
+    size_t memory_usage = 0;
+    for (const auto& status_postings : word_postings_) {
+        for (const auto& postings : status_postings) {
+            memory_usage += sizeof(postings) + postings.capacity() * sizeof(Posting);
+        }
+    }
+    for (const auto& status_postings : compressed_postings_) {
+        for (const auto& postings : status_postings) {
+            memory_usage += postings.GetMemoryUsage();
+        }
+    }
+    memory_usage += rating_ranges_.size() * sizeof(rating_ranges_.front());
+    return memory_usage;
+}
+
+void SearchServer::SaveIndex(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Cannot open file " + path);
+    }
+
+    uint64_t posting_count = 0;
+    for (WordId word_id = 0; word_id < word_postings_.size(); ++word_id) {
+        posting_count += GetPostingCount(word_id);
+    }
+    IndexFileHeader header{};
+    std::memcpy(header.magic, INDEX_FILE_MAGIC, sizeof(header.magic));
+    header.version = INDEX_FILE_VERSION;
+    header.posting_size = sizeof(IndexFilePosting);
+    header.stop_word_count = stop_words_.size();
+    header.word_count = id_to_word_.size();
+    header.posting_count = posting_count;
+    header.document_count = documents_.size();
+    WriteArray(out, &header, 1);
+
+    WriteStrings(out, stop_words_);
+    WriteStrings(out, id_to_word_);
+
+    std::vector<uint64_t> posting_offsets = {0};
+    for (WordId word_id = 0; word_id < word_postings_.size(); ++word_id) {
+        posting_offsets.push_back(posting_offsets.back() + GetPostingCount(word_id));
+    }
+    WriteArray(out, posting_offsets.data(), posting_offsets.size());
+    for (WordId word_id = 0; word_id < word_postings_.size(); ++word_id) {
+        ForEachPosting(word_id, [&out](int document_id, double term_freq, const DocumentData&) {
+            const IndexFilePosting file_posting{document_id, 0, term_freq};
+            WriteArray(out, &file_posting, 1);
+        });
+    }
+
+    for (const auto& [document_id, document_data] : documents_) {
+        const IndexFileDocument file_document{document_id, document_data.rating, static_cast<int32_t>(document_data.status), document_data.word_count};
+        WriteArray(out, &file_document, 1);
+    }
+
+    if (!out) {
+        throw std::runtime_error("Cannot write index to " + path);
+    }
+}
+
+SearchServer SearchServer::LoadIndex(const std::string& path, size_t max_result_document_count) {
+    const MappedFile file(path);
+    IndexFileReader reader(file.Data(), file.Size());
+
+    const IndexFileHeader header = *reader.ReadArray<IndexFileHeader>(1);
+    if (std::memcmp(header.magic, INDEX_FILE_MAGIC, sizeof(header.magic)) != 0) {
+        throw std::runtime_error(path + " is not a search index file");
+    }
+    if (header.version != INDEX_FILE_VERSION || header.posting_size != sizeof(IndexFilePosting)) {
+        throw std::runtime_error("Unsupported search index version in " + path);
+    }
+
+    // счётчики сверяются с размером файла до выделения памяти под них: каждая строка занимает
+    // хотя бы смещение, каждое слово — ещё и смещение своих вхождений
+    const uint64_t remaining_size = reader.GetRemainingSize();
+    if (header.stop_word_count >= remaining_size / sizeof(uint64_t)
+        || header.word_count >= remaining_size / (2 * sizeof(uint64_t))
+        || header.posting_count > remaining_size / sizeof(IndexFilePosting)
+        || header.document_count > remaining_size / sizeof(IndexFileDocument)
+        || (header.stop_word_count + 1) * sizeof(uint64_t) + (header.word_count + 1) * 2 * sizeof(uint64_t)
+               + header.posting_count * sizeof(IndexFilePosting) + header.document_count * sizeof(IndexFileDocument) > remaining_size) {
+        throw std::runtime_error("Index file is truncated");
+    }
+
+    SearchServer search_server(reader.ReadStrings(header.stop_word_count), max_result_document_count);
+    const auto words = reader.ReadStrings(header.word_count);
+    const uint64_t* posting_offsets = reader.ReadOffsets(header.word_count);
+    const IndexFilePosting* postings = reader.ReadArray<IndexFilePosting>(header.posting_count);
+    const IndexFileDocument* documents = reader.ReadArray<IndexFileDocument>(header.document_count);
+
+    for (uint64_t i = 0; i < header.document_count; ++i) {
+        const auto& [document_id, rating, status, word_count] = documents[i];
+        // word_count == 0 допустим: такой документ без слов, и ниже у него не должно быть вхождений
+        if (document_id < 0 || word_count < 0
+            || status < static_cast<int32_t>(DocumentStatus::ACTUAL) || status > static_cast<int32_t>(DocumentStatus::REMOVED)) {
+            throw std::runtime_error("Index file is corrupted");
+        }
+        if (!search_server.documents_.emplace(document_id, DocumentData{rating, static_cast<DocumentStatus>(status), word_count, {}}).second) {
+            throw std::runtime_error("Index file is corrupted");
+        }
+        search_server.total_word_count_ += word_count;
+        search_server.UpdateDocumentLookup(document_id);
+        search_server.document_ids_.insert(document_id);
+    }
+    // id слов в файле и в загруженном индексе могут не совпадать: стоп-слова получают id первыми
+    for (uint64_t file_word_id = 0; file_word_id < header.word_count; ++file_word_id) {
+        const uint64_t postings_begin = posting_offsets[file_word_id];
+        const uint64_t postings_end = posting_offsets[file_word_id + 1];
+        if (postings_begin > postings_end || postings_end > header.posting_count) {
+            throw std::runtime_error("Index file is corrupted");
+        }
+        if (postings_begin == postings_end) {
+            continue;
+        }
+        const WordId word_id = search_server.GetOrAddWordId(words[file_word_id]);
+        if (search_server.GetPostingCount(word_id) > 0 || search_server.is_stop_word_[word_id]) {
+            throw std::runtime_error("Index file is corrupted");
+        }
+        auto& word_postings = search_server.word_postings_[word_id];
+        auto& rating_ranges = search_server.rating_ranges_[word_id];
+        for (uint64_t i = postings_begin; i < postings_end; ++i) {
+            // GallopTo и вставка в AddDocument рассчитывают на строго возрастающие id в списке слова
+            if (i > postings_begin && postings[i].document_id <= postings[i - 1].document_id) {
+                throw std::runtime_error("Index file is corrupted");
+            }
+            const auto document_it = search_server.documents_.find(postings[i].document_id);
+            if (document_it == search_server.documents_.end() || document_it->second.word_count == 0) {
+                throw std::runtime_error("Index file is corrupted");
+            }
+            const DocumentData& document_data = document_it->second;
+            const auto status = static_cast<size_t>(document_data.status);
+            word_postings[status].push_back({postings[i].document_id, document_data.rating, postings[i].term_freq});
+            rating_ranges[status].Add(document_data.rating);
+            document_it->second.word_freqs.emplace_back(word_id, postings[i].term_freq);
+        }
+    }
+    for (auto& [_, document_data] : search_server.documents_) {
+        std::sort(document_data.word_freqs.begin(), document_data.word_freqs.end());
+    }
+    search_server.PrecomputeInverseDocumentFreqs();
+    return search_server;
+}
+
+size_t SearchServer::GetMaxResultDocumentCount() const {
+    return max_result_document_count_;
+}
+
+const std::set<std::string, std::less<>>& SearchServer::GetStopWords() const {
+    return stop_words_;
 }
 
 int SearchServer::GetDocumentCount() const {
@@ -35,103 +362,356 @@ int SearchServer::GetDocumentCount() const {
 }
 
 int SearchServer::GetDocumentId(int index) const {
-    return document_ids_.at(index);
+    if (index < 0 || index >= GetDocumentCount()) {
+        throw std::out_of_range("Invalid document index");
+    }
+    return *std::next(document_ids_.begin(), index);
 }
 
-std::tuple<std::vector<std::string>, DocumentStatus> SearchServer::MatchDocument(const std::string& raw_query, int document_id) const {
-    const auto query = ParseQuery(raw_query);
-    std::vector<std::string> matched_words;
-    
-    for (const std::string& word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+std::set<int>::const_iterator SearchServer::begin() const {
+    return document_ids_.begin();
+}
+
+std::set<int>::const_iterator SearchServer::end() const {
+    return document_ids_.end();
+}
+
+std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document_id) const {
+    std::map<std::string_view, double> word_freqs;
+    for (const auto& [word_id, term_freq] : GetWordIdFrequencies(document_id)) {
+        word_freqs.emplace(id_to_word_[word_id], term_freq);
+    }
+    return word_freqs;
+}
+
+const std::vector<std::pair<SearchServer::WordId, double>>& SearchServer::GetWordIdFrequencies(int document_id) const {
+    static const std::vector<std::pair<WordId, double>> empty_word_freqs;
+    const auto it = documents_.find(document_id);
+    if (it == documents_.end()) {
+        return empty_word_freqs;
+    }
+    return it->second.word_freqs;
+}
+
+void SearchServer::RemoveDocument(int document_id) {
+    RemoveDocument(std::execution::seq, document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    return MatchDocument(std::execution::seq, raw_query, document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::sequenced_policy&, std::string_view raw_query, int document_id) const {
+    return MatchDocument(std::execution::seq, PrepareQuery(raw_query), document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::parallel_policy& policy, std::string_view raw_query, int document_id) const {
+    return MatchDocument(policy, PrepareQuery(raw_query), document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const PreparedQuery& query, int document_id) const {
+    return MatchDocument(std::execution::seq, query, document_id);
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::sequenced_policy&, const PreparedQuery& prepared_query, int document_id) const {
+    const auto& document_data = documents_.at(document_id);
+    PreparedQuery buffer;
+    const auto& query = ResolveUnknownWords(prepared_query, buffer);
+    std::vector<std::string_view> matched_words;
+
+    for (const WordId word_id : query.minus_words) {
+        if (ContainsWord(document_data, word_id)) {
+            return {matched_words, document_data.status};
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-                matched_words.push_back(word);
+    }
+
+    for (const WordId word_id : query.plus_words) {
+        if (ContainsWord(document_data, word_id)) {
+            matched_words.push_back(id_to_word_[word_id]);
         }
     }
-    
-    for (const std::string& word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+    std::sort(matched_words.begin(), matched_words.end());
+
+    return {matched_words, document_data.status};
+}
+
+std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(const std::execution::parallel_policy& policy, const PreparedQuery& prepared_query, int document_id) const {
+    const auto& document_data = documents_.at(document_id);
+    PreparedQuery buffer;
+    const auto& query = ResolveUnknownWords(prepared_query, buffer);
+
+    if (std::any_of(policy, query.minus_words.begin(), query.minus_words.end(),
+            [&document_data](WordId word_id) {
+                return ContainsWord(document_data, word_id);
+            })) {
+        return {std::vector<std::string_view>{}, document_data.status};
+    }
+
+    std::vector<std::string_view> matched_words(query.plus_words.size());
+    std::transform(policy, query.plus_words.begin(), query.plus_words.end(), matched_words.begin(),
+        [this, &document_data](WordId word_id) {
+            return ContainsWord(document_data, word_id) ? std::string_view(id_to_word_[word_id]) : std::string_view{};
+        });
+    matched_words.erase(std::remove(matched_words.begin(), matched_words.end(), std::string_view{}), matched_words.end());
+    std::sort(policy, matched_words.begin(), matched_words.end());
+
+    return {matched_words, document_data.status};
+}
+
+uint64_t SearchServer::GenerateServerId() {
+    static std::atomic<uint64_t> last_server_id = 0;
+    return last_server_id.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+SearchServer::WordId SearchServer::GetOrAddWordId(std::string_view word) {
+    if (const auto word_id = FindWordId(word)) {
+        return *word_id;
+    }
+    const auto word_id = static_cast<WordId>(id_to_word_.size());
+    id_to_word_.emplace_back(word);
+    word_to_id_.emplace(id_to_word_.back(), word_id);
+    is_stop_word_.push_back(false);
+    word_postings_.emplace_back();
+    rating_ranges_.emplace_back();
+    for (auto& cache : idf_caches_) {
+        cache.word_idfs.emplace_back();
+    }
+    return word_id;
+}
+
+const SearchServer::DocumentData& SearchServer::GetDocumentData(int document_id) const {
+    if (static_cast<size_t>(document_id) < document_lookup_.size()) {
+        if (const DocumentData* document_data = document_lookup_[document_id]) {
+            return *document_data;
+        }
+    }
+    return documents_.at(document_id);
+}
+
+void SearchServer::UpdateDocumentLookup(int document_id) {
+    const size_t old_size = document_lookup_.size();
+    if (static_cast<size_t>(document_id) >= old_size) {
+        if (static_cast<size_t>(document_id) > 2 * documents_.size() + DENSE_DOCUMENT_ID_SLACK) {
+            return;
         }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.clear();
-            break;
+        // документы, добавленные, пока их id были за пределами таблицы, переносятся в неё
+        document_lookup_.resize(document_id + 1, nullptr);
+        for (auto it = documents_.lower_bound(static_cast<int>(old_size)); it != documents_.end() && it->first <= document_id; ++it) {
+            document_lookup_[it->first] = &it->second;
         }
+        return;
     }
-    
-    return {matched_words, documents_.at(document_id).status};
+    const auto it = documents_.find(document_id);
+    document_lookup_[document_id] = it == documents_.end() ? nullptr : &it->second;
 }
 
-bool SearchServer::IsStopWord(const std::string& word) const {
-    return stop_words_.count(word) > 0;
+bool SearchServer::AreDocumentIdsDense() const {
+    return documents_.empty() || static_cast<size_t>(documents_.rbegin()->first) < document_lookup_.size();
 }
 
-bool SearchServer::IsValidWord(const std::string& word) {
-    return none_of(word.begin(), word.end(), [](char c) {
-            return c >= '\0' && c < ' ';
-    });
+SearchServer::RelevanceAccumulatorGuard::RelevanceAccumulatorGuard(RelevanceAccumulator& accumulator)
+    : accumulator_(accumulator) {
+}
+
+SearchServer::RelevanceAccumulatorGuard::~RelevanceAccumulatorGuard() {
+    for (const int document_id : accumulator_.touched_document_ids) {
+        accumulator_.relevances[document_id] = 0.0;
+        accumulator_.states[document_id] = RelevanceAccumulator::State::UNTOUCHED;
+    }
+    accumulator_.touched_document_ids.clear();
 }
 
-std::vector<std::string> SearchServer::SplitIntoWordsNoStop(const std::string& text) const {
-    std::vector<std::string> words;
-    for (const std::string& word : SplitIntoWords(text)) {
-        if (!IsValidWord(word)) {
-            throw std::invalid_argument("Word " + word + " is invalid");
+SearchServer::RelevanceAccumulator& SearchServer::GetThreadRelevanceAccumulator() {
+    static thread_local RelevanceAccumulator accumulator;
+    return accumulator;
+}
+
+std::optional<SearchServer::WordId> SearchServer::FindWordId(std::string_view word) const {
+    const auto it = word_to_id_.find(word);
+    if (it == word_to_id_.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+namespace {
+
+template <typename T>
+void SortUnique(std::vector<T>& values) {
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+}
+
+}  // namespace
+
+SearchServer::PreparedQuery SearchServer::PrepareQuery(std::string_view raw_query) const {
+    // стоп-слова отсеиваются по флагу в словаре, а не поиском в stop_words_
+    const auto query = ParseQuery(raw_query, {}, false);
+    PreparedQuery result;
+    result.dictionary_size = id_to_word_.size();
+    result.server_id = server_id_;
+    const auto resolve_words = [this](const std::vector<std::string_view>& words, std::vector<WordId>& word_ids, std::vector<std::string>& unknown_words) {
+        for (std::string_view word : words) {
+            const auto word_id = FindWordId(word);
+            if (!word_id) {
+                unknown_words.emplace_back(word);
+            } else if (!is_stop_word_[*word_id]) {
+                word_ids.push_back(*word_id);
+            }
         }
-        if (!IsStopWord(word)) {
-            words.push_back(word);
+        SortUnique(word_ids);
+        SortUnique(unknown_words);
+    };
+    resolve_words(query.plus_words, result.plus_words, result.unknown_plus_words);
+    resolve_words(query.minus_words, result.minus_words, result.unknown_minus_words);
+    return result;
+}
+
+const SearchServer::PreparedQuery& SearchServer::ResolveUnknownWords(const PreparedQuery& query, PreparedQuery& buffer) const {
+    // id слов чужого запроса указывают в чужой словарь и могут выйти за границы списков этого сервера
+    if (query.server_id != server_id_) {
+        throw std::invalid_argument("Prepared query belongs to another server");
+    }
+    if (query.dictionary_size == id_to_word_.size() || (query.unknown_plus_words.empty() && query.unknown_minus_words.empty())) {
+        return query;
+    }
+    buffer = query;
+    buffer.dictionary_size = id_to_word_.size();
+    const auto resolve_words = [this](std::vector<std::string>& unknown_words, std::vector<WordId>& word_ids) {
+        std::vector<std::string> still_unknown_words;
+        for (std::string& word : unknown_words) {
+            const auto word_id = FindWordId(word);
+            if (!word_id) {
+                still_unknown_words.push_back(std::move(word));
+            } else if (!is_stop_word_[*word_id]) {
+                word_ids.push_back(*word_id);
+            }
         }
+        unknown_words = std::move(still_unknown_words);
+        SortUnique(word_ids);
+    };
+    resolve_words(buffer.unknown_plus_words, buffer.plus_words);
+    resolve_words(buffer.unknown_minus_words, buffer.minus_words);
+    return buffer;
+}
+
+const std::vector<SearchServer::Posting>& SearchServer::GetPostings(WordId word_id, DocumentStatus status, std::vector<Posting>& buffer) const {
+    if (!postings_compressed_) {
+        return word_postings_[word_id][static_cast<size_t>(status)];
     }
-        return words;
+    buffer.clear();
+    buffer.reserve(GetPostingCount(word_id, status));
+    ForEachStatusPosting(word_id, status, [&buffer](int document_id, double term_freq, const DocumentData& document_data) {
+        buffer.push_back({document_id, document_data.rating, term_freq});
+    });
+    return buffer;
 }
 
-int  SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
-    if (ratings.empty()) {
-        return 0;
+SearchServer::PostingIterator SearchServer::GallopTo(PostingIterator first, PostingIterator last, int document_id) {
+    // шаг растёт вдвое, пока не перешагнём document_id, затем бинарный поиск на последнем шаге
+    size_t step = 1;
+    PostingIterator low = first;
+    while (static_cast<size_t>(last - low) > step && std::next(low, step)->document_id < document_id) {
+        low += step;
+        step *= 2;
     }
-    int rating_sum = 0;
-    for (const int rating : ratings) {
-        rating_sum += rating;
+    const PostingIterator high = static_cast<size_t>(last - low) > step ? std::next(low, step + 1) : last;
+    return std::lower_bound(low, high, document_id, [](const Posting& posting, int id) {
+        return posting.document_id < id;
+    });
+}
+
+void SearchServer::RatingRange::Add(int rating) {
+    min_rating = std::min(min_rating, rating);
+    max_rating = std::max(max_rating, rating);
+}
+
+bool SearchServer::RatingRange::Intersects(const DocumentFilter& filter) const {
+    return min_rating <= filter.max_rating && filter.min_rating <= max_rating;
+}
+
+bool SearchServer::RatingRange::IsWithin(const DocumentFilter& filter) const {
+    return filter.min_rating <= min_rating && max_rating <= filter.max_rating;
+}
+
+bool SearchServer::ContainsWord(const DocumentData& document_data, WordId word_id) {
+    const auto& word_freqs = document_data.word_freqs;
+    const auto it = std::lower_bound(word_freqs.begin(), word_freqs.end(), word_id,
+        [](const std::pair<WordId, double>& word_freq, WordId id) {
+            return word_freq.first < id;
+        });
+    return it != word_freqs.end() && it->first == word_id;
+}
+
+size_t SearchServer::GetPostingCount(WordId word_id) const {
+    size_t posting_count = 0;
+    for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+        posting_count += GetPostingCount(word_id, static_cast<DocumentStatus>(status));
     }
-    
-    return rating_sum / static_cast<int>(ratings.size());
+    return posting_count;
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string& text) const {
-    if (text.empty()) {
-        throw std::invalid_argument("Query word is empty");
+size_t SearchServer::GetPostingCount(WordId word_id, DocumentStatus status) const {
+    const auto status_index = static_cast<size_t>(status);
+    return postings_compressed_ ? compressed_postings_[word_id][status_index].Size() : word_postings_[word_id][status_index].size();
+}
+
+void SearchServer::DecompressPostings() {
+    if (!postings_compressed_) {
+        return;
     }
-    std::string word = text;
-    bool is_minus = false;
-    if (word[0] == '-') {
-        is_minus = true;
-        word = word.substr(1);
+    for (WordId word_id = 0; word_id < compressed_postings_.size(); ++word_id) {
+        for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+            auto& postings = word_postings_[word_id][status];
+            postings.reserve(compressed_postings_[word_id][status].Size());
+            ForEachStatusPosting(word_id, static_cast<DocumentStatus>(status), [&postings](int document_id, double term_freq, const DocumentData& document_data) {
+                postings.push_back({document_id, document_data.rating, term_freq});
+            });
+        }
     }
-    if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
-        throw std::invalid_argument("Query word " + text + " is invalid");
+    std::vector<std::array<CompressedPostingList, DOCUMENT_STATUS_COUNT>>().swap(compressed_postings_);
+    postings_compressed_ = false;
+}
+
+void SearchServer::InvalidateInverseDocumentFreq(WordId word_id) {
+    for (auto& cache : idf_caches_) {
+        cache.word_idfs[word_id].document_count.store(-1, std::memory_order_relaxed);
     }
-    
-    return {word, is_minus, IsStopWord(word)};
-}
-
-SearchServer::Query SearchServer::ParseQuery(const std::string& text) const {
-    SearchServer::Query result;
-    for (const std::string& word : SplitIntoWords(text)) {
-        const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                result.minus_words.insert(query_word.data);
-            } else {
-                result.plus_words.insert(query_word.data);
-            }
+}
+
+const SearchServer::InverseDocumentFreqCache& SearchServer::GetInverseDocumentFreqCache(InverseDocumentFreqFunction compute_inverse_document_freq) const {
+    std::lock_guard guard(*idf_caches_mutex_);
+    for (const auto& cache : idf_caches_) {
+        if (cache.compute_inverse_document_freq == compute_inverse_document_freq) {
+            return cache;
         }
     }
-    
-    return result;
+    idf_caches_.push_back({compute_inverse_document_freq, std::deque<CachedInverseDocumentFreq>(word_postings_.size())});
+    return idf_caches_.back();
+}
+
+double SearchServer::ComputeWordInverseDocumentFreq(WordId word_id, const InverseDocumentFreqCache& cache) const {
+    auto& cached_idf = cache.word_idfs[word_id];
+    const int document_count = GetDocumentCount();
+    if (cached_idf.document_count.load(std::memory_order_acquire) == document_count) {
+        return cached_idf.value.load(std::memory_order_relaxed);
+    }
+    // параллельные запросы могут пересчитать одно слово одновременно, но запишут одно и то же значение
+    const double inverse_document_freq = cache.compute_inverse_document_freq(document_count, static_cast<int>(GetPostingCount(word_id)));
+    cached_idf.value.store(inverse_document_freq, std::memory_order_relaxed);
+    cached_idf.document_count.store(document_count, std::memory_order_release);
+    return inverse_document_freq;
+}
+
+double SearchServer::ComputeAverageDocumentLength() const {
+    return documents_.empty() ? 0.0 : total_word_count_ / static_cast<double>(documents_.size());
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string& word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
-}
\ No newline at end of file
+std::vector<Document> SearchServer::BuildMatchedDocuments(const std::map<int, double>& document_to_relevance) const {
+    std::vector<Document> matched_documents;
+    matched_documents.reserve(document_to_relevance.size());
+    for (const auto &[document_id, relevance] : document_to_relevance) {
+        matched_documents.push_back({document_id, relevance, GetDocumentData(document_id).rating});
+    }
+    return matched_documents;
+}
@@ -1,134 +1,1245 @@
 #pragma once
 
+#include "compressed_posting_list.h"
 #include "document.h"
+#include "ranking.h"
 #include "read_input_functions.h"
+#include "search_metrics.h"
 #include "string_processing.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <execution>
+#include <iterator>
+#include <limits>
+#include <list>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
 #include <set>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
-const int MAX_RESULT_DOCUMENT_COUNT = 5;
-const double EPSILON = 1e-6;
+const size_t MAX_RESULT_DOCUMENT_COUNT = 5;
+// число диапазонов id документов, по которым параллельный поиск складывает релевантность
+const size_t RELEVANCE_BUCKET_COUNT = 101;
+// плотная таблица документов растёт, пока id не больше 2 * число документов + DENSE_DOCUMENT_ID_SLACK
+const size_t DENSE_DOCUMENT_ID_SLACK = 1024;
 
+// Сервер только перемещается: document_lookup_ хранит указатели на узлы documents_, а word_to_id_
+// и частоты слов документов — string_view на строки id_to_word_. При перемещении map и deque узлы
+// и строки остаются на месте, а почленная копия ссылалась бы на данные исходного сервера.
 class SearchServer {
 public:
+    using WordId = uint32_t;
+
+    // Запрос, разобранный один раз: слова без повторов и стоп-слов, переведённые в id словаря.
+    // Годится только для сервера, который его подготовил: сервер сверяет server_id и бросает
+    // std::invalid_argument для чужого запроса. Слова, которых не было в словаре, хранятся
+    // строками и ищутся снова, если к моменту поиска словарь вырос.
+    struct PreparedQuery {
+        std::vector<WordId> plus_words;
+        std::vector<WordId> minus_words;
+        std::vector<std::string> unknown_plus_words;
+        std::vector<std::string> unknown_minus_words;
+        size_t dictionary_size = 0;
+        uint64_t server_id = 0;
+    };
+
+    // max_result_document_count — число результатов FindTopDocuments, если оно не задано в вызове
     template <typename StringContainer>
-    explicit SearchServer(const StringContainer& stop_words);
+    explicit SearchServer(const StringContainer& stop_words, size_t max_result_document_count = MAX_RESULT_DOCUMENT_COUNT);
 
-    explicit SearchServer(const std::string& stop_words_text);
+    explicit SearchServer(const std::string& stop_words_text, size_t max_result_document_count = MAX_RESULT_DOCUMENT_COUNT);
+    explicit SearchServer(std::string_view stop_words_text, size_t max_result_document_count = MAX_RESULT_DOCUMENT_COUNT);
+
+    SearchServer(const SearchServer&) = delete;
+    SearchServer& operator=(const SearchServer&) = delete;
+    SearchServer(SearchServer&&) = default;
     
-    void AddDocument(int document_id, const std::string& document, DocumentStatus status, const std::vector<int>& ratings);
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
 
-    template <typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate) const;
+    void AddDocuments(const std::vector<RawDocument>& documents);
+
+    template <typename ExecutionPolicy>
+    void AddDocuments(ExecutionPolicy&& policy, const std::vector<RawDocument>& documents);
+
+    PreparedQuery PrepareQuery(std::string_view raw_query) const;
+
+    // RankingPolicy задаёт формулу релевантности: TfIdfRanking, Bm25Ranking или своя (см. ranking.h)
+    template <typename RankingPolicy = TfIdfRanking, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+
+    template <typename RankingPolicy = TfIdfRanking>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status) const;
+
+    template <typename RankingPolicy = TfIdfRanking>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+
+    template <typename RankingPolicy = TfIdfRanking, typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate) const;
+
+    template <typename RankingPolicy = TfIdfRanking, typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status) const;
+
+    template <typename RankingPolicy = TfIdfRanking, typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const;
+
+    template <typename RankingPolicy = TfIdfRanking, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate) const;
+
+    template <typename RankingPolicy = TfIdfRanking>
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentStatus status) const;
+
+    template <typename RankingPolicy = TfIdfRanking>
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query) const;
+
+    template <typename RankingPolicy = TfIdfRanking, typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query, DocumentPredicate document_predicate) const;
+
+    template <typename RankingPolicy = TfIdfRanking, typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query, DocumentStatus status) const;
+
+    template <typename RankingPolicy = TfIdfRanking, typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query) const;
 
-    std::vector<Document> FindTopDocuments(const std::string& raw_query, DocumentStatus status) const;
-    std::vector<Document> FindTopDocuments(const std::string& raw_query) const;
+    // Число результатов для одного вызова; фильтр по статусу передаётся как DocumentFilter{status}
+    template <typename RankingPolicy = TfIdfRanking, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_document_count) const;
+
+    template <typename RankingPolicy = TfIdfRanking, typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_document_count) const;
+
+    template <typename RankingPolicy = TfIdfRanking, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate, size_t max_result_document_count) const;
+
+    template <typename RankingPolicy = TfIdfRanking, typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query, DocumentPredicate document_predicate, size_t max_result_document_count) const;
+
+    // Режим «И»: находит только документы, в которых есть все плюс-слова запроса
+    template <typename RankingPolicy = TfIdfRanking, typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsWithAllWords(std::string_view raw_query, DocumentPredicate document_predicate) const;
+
+    template <typename RankingPolicy = TfIdfRanking>
+    std::vector<Document> FindTopDocumentsWithAllWords(std::string_view raw_query, DocumentStatus status) const;
+
+    template <typename RankingPolicy = TfIdfRanking>
+    std::vector<Document> FindTopDocumentsWithAllWords(std::string_view raw_query) const;
+
+    template <typename RankingPolicy = TfIdfRanking, typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsWithAllWords(const PreparedQuery& query, DocumentPredicate document_predicate) const;
+
+    template <typename RankingPolicy = TfIdfRanking>
+    std::vector<Document> FindTopDocumentsWithAllWords(const PreparedQuery& query, DocumentStatus status) const;
+
+    template <typename RankingPolicy = TfIdfRanking>
+    std::vector<Document> FindTopDocumentsWithAllWords(const PreparedQuery& query) const;
+
+    template <typename RankingPolicy = TfIdfRanking, typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsWithAllWords(std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_document_count) const;
+
+    template <typename RankingPolicy = TfIdfRanking, typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsWithAllWords(const PreparedQuery& query, DocumentPredicate document_predicate, size_t max_result_document_count) const;
+
+    // Считает IDF всех слов заранее, например после массовой загрузки. Кэш остаётся
+    // действительным до следующего изменения числа документов.
+    void PrecomputeInverseDocumentFreqs();
+
+    // Сжимает списки вхождений индекса, который только читается. AddDocument, AddDocuments,
+    // RemoveDocument и RemoveDocuments молча распаковывают весь индекс, и он остаётся
+    // несжатым до следующего CompressPostings; удаление отсутствующих id его не распаковывает.
+    void CompressPostings();
+    bool ArePostingsCompressed() const;
+    size_t GetPostingsMemoryUsage() const;
+
+    void SaveIndex(const std::string& path) const;
+    // Снимок читается через отображение в память, но словарь, вхождения и документы копируются
+    // в структуры сервера: после загрузки файл не нужен, а память занята так же, как после
+    // AddDocument. Загрузка быстрее повторной индексации, потому что тексты не разбираются.
+    static SearchServer LoadIndex(const std::string& path, size_t max_result_document_count = MAX_RESULT_DOCUMENT_COUNT);
+
+    size_t GetMaxResultDocumentCount() const;
+
+    const std::set<std::string, std::less<>>& GetStopWords() const;
     int GetDocumentCount() const;
     int GetDocumentId(int index) const;
-    std::tuple<std::vector<std::string>, DocumentStatus> MatchDocument(const std::string& raw_query, int document_id) const;
+    std::set<int>::const_iterator begin() const;
+    std::set<int>::const_iterator end() const;
+    // строится по запросу из частот документа по id слов
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+    // частоты слов документа, отсортированные по id слова, без повторов и стоп-слов
+    const std::vector<std::pair<WordId, double>>& GetWordIdFrequencies(int document_id) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(std::string_view raw_query, int document_id) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::sequenced_policy&, std::string_view raw_query, int document_id) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy&, std::string_view raw_query, int document_id) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const PreparedQuery& query, int document_id) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::sequenced_policy&, const PreparedQuery& query, int document_id) const;
+    std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::execution::parallel_policy&, const PreparedQuery& query, int document_id) const;
+
+    void RemoveDocument(int document_id);
+
+    template <typename ExecutionPolicy>
+    void RemoveDocument(ExecutionPolicy&& policy, int document_id);
+
+    template <typename ExecutionPolicy>
+    void RemoveDocuments(ExecutionPolicy&& policy, const std::vector<int>& document_ids);
 
 private:
     struct DocumentData {
         int rating;
         DocumentStatus status;
+        int word_count;
+        // отсортированы по id слова; одна плоская таблица вместо map по строкам и отдельного списка id
+        std::vector<std::pair<WordId, double>> word_freqs;
+    };
+
+
+    // Статус документа задан участком списка, в котором лежит вхождение. Рейтинг занимает место
+    // выравнивания: по нему DocumentFilter отсеивает документ без обращения к его данным.
+    struct Posting {
+        int document_id;
+        int rating;
+        double term_freq;
     };
-    
-    const std::set<std::string> stop_words_;
-    std::map<std::string, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, DocumentData> documents_;
-    std::vector<int> document_ids_;
 
-    bool IsStopWord(const std::string& word) const;
+    using PostingIterator = std::vector<Posting>::const_iterator;
 
-    static bool IsValidWord(const std::string& word);
+    // Вхождения слова, разбитые на участки по статусу документа; в каждом участке id возрастают
+    using StatusPostings = std::array<std::vector<Posting>, DOCUMENT_STATUS_COUNT>;
 
-    std::vector<std::string> SplitIntoWordsNoStop(const std::string& text) const;
+    // Наименьший и наибольший рейтинг документов участка; у пустого участка min_rating > max_rating
+    struct RatingRange {
+        int min_rating = std::numeric_limits<int>::max();
+        int max_rating = std::numeric_limits<int>::min();
 
-    static int ComputeAverageRating(const std::vector<int>& ratings);
+        void Add(int rating);
+        bool Intersects(const DocumentFilter& filter) const;
+        bool IsWithin(const DocumentFilter& filter) const;
+    };
 
-    struct QueryWord {
-        std::string data;
-        bool is_minus;
-        bool is_stop;
+    // Накопитель релевантности, индексированный id документа; переиспользуется запросами одного потока
+    struct RelevanceAccumulator {
+        enum class State : uint8_t {
+            UNTOUCHED,
+            ACCEPTED,
+            REJECTED,
+            // в документе есть минус-слово
+            EXCLUDED,
+        };
+
+        std::vector<double> relevances;
+        std::vector<State> states;
+        std::vector<int> touched_document_ids;
     };
 
-    QueryWord ParseQueryWord(const std::string& text) const;
+    // Возвращает накопитель в исходное состояние при любом выходе из запроса, в том числе
+    // по исключению из предиката или политики ранжирования: иначе следующий запрос потока
+    // увидел бы чужие состояния и релевантности
+    class RelevanceAccumulatorGuard {
+    public:
+        explicit RelevanceAccumulatorGuard(RelevanceAccumulator& accumulator);
+        RelevanceAccumulatorGuard(const RelevanceAccumulatorGuard&) = delete;
+        RelevanceAccumulatorGuard& operator=(const RelevanceAccumulatorGuard&) = delete;
+        ~RelevanceAccumulatorGuard();
 
-    struct Query {
-        std::set<std::string> plus_words;
-        std::set<std::string> minus_words;
+    private:
+        RelevanceAccumulator& accumulator_;
     };
 
-    Query ParseQuery(const std::string& text) const;
+    // IDF слова, посчитанный для document_count документов; -1 означает, что значение устарело
+    struct CachedInverseDocumentFreq {
+        std::atomic<double> value{0.0};
+        std::atomic<int> document_count{-1};
+    };
+
+    // IDF слов, посчитанные формулой ComputeInverseDocumentFreq одной политики ранжирования
+    using InverseDocumentFreqFunction = double (*)(int, int);
+    struct InverseDocumentFreqCache {
+        InverseDocumentFreqFunction compute_inverse_document_freq;
+        mutable std::deque<CachedInverseDocumentFreq> word_idfs;
+    };
+
+    const std::set<std::string, std::less<>> stop_words_;
+    // свой у каждого созданного сервера, начиная с 1; перемещённый сервер сохраняет номер вместе со словарём
+    const uint64_t server_id_ = GenerateServerId();
+    // deque не перемещает строки при росте, поэтому ключи word_to_id_ остаются валидными
+    std::deque<std::string> id_to_word_;
+    std::unordered_map<std::string_view, WordId> word_to_id_;
+    std::vector<bool> is_stop_word_;
+    std::vector<StatusPostings> word_postings_;
+    std::vector<std::array<CompressedPostingList, DOCUMENT_STATUS_COUNT>> compressed_postings_;
+    // границы рейтинга участков, общие для обычных и сжатых списков
+    std::vector<std::array<RatingRange, DOCUMENT_STATUS_COUNT>> rating_ranges_;
+    bool postings_compressed_ = false;
+    // кэш политики создаётся при первом запросе с ней; узлы list при этом не перемещаются
+    mutable std::list<InverseDocumentFreqCache> idf_caches_;
+    mutable std::unique_ptr<std::mutex> idf_caches_mutex_ = std::make_unique<std::mutex>();
+    std::map<int, DocumentData> documents_;
+    // documents_ по id для плотных id; документы с id за пределами таблицы есть только в documents_
+    std::vector<const DocumentData*> document_lookup_;
+    std::set<int> document_ids_;
+    uint64_t total_word_count_ = 0;
+    size_t max_result_document_count_;
+
+    static uint64_t GenerateServerId();
+
+    WordId GetOrAddWordId(std::string_view word);
+
+    const DocumentData& GetDocumentData(int document_id) const;
+
+    void UpdateDocumentLookup(int document_id);
+
+    bool AreDocumentIdsDense() const;
+
+    static RelevanceAccumulator& GetThreadRelevanceAccumulator();
+
+    std::optional<WordId> FindWordId(std::string_view word) const;
+
+    size_t GetPostingCount(WordId word_id) const;
+    size_t GetPostingCount(WordId word_id, DocumentStatus status) const;
+
+    // Участок списка вхождений слова; сжатый участок распаковывается в buffer
+    const std::vector<Posting>& GetPostings(WordId word_id, DocumentStatus status, std::vector<Posting>& buffer) const;
+
+    // Первое вхождение из [first, last) с id не меньше document_id (экспоненциальный поиск)
+    static PostingIterator GallopTo(PostingIterator first, PostingIterator last, int document_id);
+
+    static bool ContainsWord(const DocumentData& document_data, WordId word_id);
+
+    // Все вхождения слова по возрастанию id: участки статусов сливаются
+    template <typename Function>
+    void ForEachPosting(WordId word_id, Function function) const;
+
+    // Вхождения участка одного статуса по возрастанию id
+    template <typename Function>
+    void ForEachStatusPosting(WordId word_id, DocumentStatus status, Function function) const;
+
+    // Для DocumentFilter просматривается только участок его статуса, а участок, рейтинги которого
+    // не пересекают диапазон фильтра, пропускается целиком. Рейтинг отдельного вхождения сверяется
+    // без обращения к данным документа; в сжатых списках рейтинга нет, и его проверяет вызывающий.
+    template <typename DocumentPredicate, typename Function>
+    void ForEachPosting(WordId word_id, const DocumentPredicate& document_predicate, Function function) const;
+
+    // Для DocumentFilter — только документы из участка его статуса
+    template <typename DocumentPredicate, typename Function>
+    void ForEachDocumentId(WordId word_id, const DocumentPredicate& document_predicate, Function function) const;
+
+    void DecompressPostings();
+
+    void InvalidateInverseDocumentFreq(WordId word_id);
+
+    const InverseDocumentFreqCache& GetInverseDocumentFreqCache(InverseDocumentFreqFunction compute_inverse_document_freq) const;
+
+    double ComputeWordInverseDocumentFreq(WordId word_id, const InverseDocumentFreqCache& cache) const;
+
+    // Кэш политики ищется под блокировкой, поэтому запрос берёт его один раз, до обхода слов
+    template <typename RankingPolicy>
+    const InverseDocumentFreqCache& GetInverseDocumentFreqCache() const;
+
+    double ComputeAverageDocumentLength() const;
+
+    // Возвращает query или, если словарь вырос и неизвестные слова появились, обновлённую копию в buffer
+    const PreparedQuery& ResolveUnknownWords(const PreparedQuery& query, PreparedQuery& buffer) const;
+
+    // Поиск без записи метрик: их дописывает в metrics и записывает вызывающая функция
+    template <typename RankingPolicy, typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query, DocumentPredicate document_predicate, size_t max_result_document_count, QueryMetrics& metrics) const;
 
-    double ComputeWordInverseDocumentFreq(const std::string& word) const;
+    template <typename RankingPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsWithAllWords(const PreparedQuery& query, DocumentPredicate document_predicate, size_t max_result_document_count, QueryMetrics& metrics) const;
+
+    template <typename RankingPolicy, typename DocumentPredicate>
+    std::vector<Document> FindAllDocumentsWithAllWords(const PreparedQuery& query, DocumentPredicate document_predicate, QueryMetrics& metrics) const;
+
+    template <typename RankingPolicy, typename DocumentPredicate>
+    std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query, DocumentPredicate document_predicate, QueryMetrics& metrics) const;
+
+    template <typename RankingPolicy, typename DocumentPredicate>
+    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy&, const PreparedQuery& query, DocumentPredicate document_predicate, QueryMetrics& metrics) const;
 
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const Query& query,DocumentPredicate document_predicate) const;
+    uint64_t CountQueryPostings(const PreparedQuery& query, const DocumentPredicate& document_predicate) const;
+
+    std::vector<Document> BuildMatchedDocuments(const std::map<int, double>& document_to_relevance) const;
 };
 
 
+static_assert(!std::is_copy_constructible_v<SearchServer> && !std::is_copy_assignable_v<SearchServer>,
+              "SearchServer holds pointers into its own containers and must not be copied");
+static_assert(std::is_move_constructible_v<SearchServer>);
+
 template <typename StringContainer>
-SearchServer::SearchServer(const StringContainer& stop_words)
-    : stop_words_(MakeUniqueNonEmptyStrings(stop_words)) {
-    if (!all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
+SearchServer::SearchServer(const StringContainer& stop_words, size_t max_result_document_count)
+    : stop_words_(MakeUniqueNonEmptyStrings(stop_words))
+    , max_result_document_count_(max_result_document_count) {
+    if (!std::all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)) {
         throw std::invalid_argument("Some of stop words are invalid");
     }
+    for (const std::string& stop_word : stop_words_) {
+        is_stop_word_[GetOrAddWordId(stop_word)] = true;
+    }
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(const std::string& raw_query, DocumentPredicate document_predicate) const {
-    const auto query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(query, document_predicate);
-    sort(matched_documents.begin(), matched_documents.end(),
-        [](const Document& lhs, const Document& rhs) {
-            if (std::abs(lhs.relevance - rhs.relevance) < EPSILON) {
-                return lhs.rating > rhs.rating;
-            } else {
-                return lhs.relevance > rhs.relevance;
+template <typename RankingPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    return FindTopDocuments<RankingPolicy>(std::execution::seq, raw_query, document_predicate);
+}
+
+template <typename RankingPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments<RankingPolicy>(std::execution::seq, raw_query, status);
+}
+
+template <typename RankingPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const {
+    return FindTopDocuments<RankingPolicy>(std::execution::seq, raw_query);
+}
+
+template <typename RankingPolicy, typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate) const {
+    return FindTopDocuments<RankingPolicy>(policy, raw_query, document_predicate, max_result_document_count_);
+}
+
+template <typename RankingPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_document_count) const {
+    return FindTopDocuments<RankingPolicy>(std::execution::seq, raw_query, document_predicate, max_result_document_count);
+}
+
+template <typename RankingPolicy, typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_document_count) const {
+    QueryMetrics metrics;
+    const PreparedQuery query = [&] {
+        MetricsPhaseTimer timer(metrics.parse_time);
+        return PrepareQuery(raw_query);
+    }();
+    auto matched_documents = FindTopDocuments<RankingPolicy>(policy, query, document_predicate, max_result_document_count, metrics);
+    if constexpr (SEARCH_METRICS_ENABLED) {
+        RecordQueryMetrics(metrics);
+    }
+    return matched_documents;
+}
+
+template <typename RankingPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate) const {
+    return FindTopDocuments<RankingPolicy>(std::execution::seq, query, document_predicate);
+}
+
+template <typename RankingPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentStatus status) const {
+    return FindTopDocuments<RankingPolicy>(std::execution::seq, query, status);
+}
+
+template <typename RankingPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query) const {
+    return FindTopDocuments<RankingPolicy>(std::execution::seq, query);
+}
+
+template <typename RankingPolicy, typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query, DocumentPredicate document_predicate) const {
+    return FindTopDocuments<RankingPolicy>(policy, query, document_predicate, max_result_document_count_);
+}
+
+template <typename RankingPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate, size_t max_result_document_count) const {
+    return FindTopDocuments<RankingPolicy>(std::execution::seq, query, document_predicate, max_result_document_count);
+}
+
+template <typename RankingPolicy, typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query, DocumentPredicate document_predicate, size_t max_result_document_count) const {
+    QueryMetrics metrics;
+    auto matched_documents = FindTopDocuments<RankingPolicy>(policy, query, document_predicate, max_result_document_count, metrics);
+    if constexpr (SEARCH_METRICS_ENABLED) {
+        RecordQueryMetrics(metrics);
+    }
+    return matched_documents;
+}
+
+template <typename RankingPolicy, typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& prepared_query, DocumentPredicate document_predicate, size_t max_result_document_count, QueryMetrics& metrics) const {
+    PreparedQuery buffer;
+    const PreparedQuery& query = [&]() -> const PreparedQuery& {
+        MetricsPhaseTimer timer(metrics.parse_time);
+        return ResolveUnknownWords(prepared_query, buffer);
+    }();
+    auto matched_documents = [&] {
+        MetricsPhaseTimer timer(metrics.score_time);
+        return FindAllDocuments<RankingPolicy>(policy, query, document_predicate, metrics);
+    }();
+    if constexpr (SEARCH_METRICS_ENABLED) {
+        metrics.postings_scanned += CountQueryPostings(query, document_predicate);
+        metrics.documents_matched += matched_documents.size();
+    }
+    MetricsPhaseTimer timer(metrics.sort_time);
+    SelectTopDocuments(matched_documents, max_result_document_count);
+    return matched_documents;
+}
+
+template <typename RankingPolicy, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocuments<RankingPolicy>(policy, raw_query, DocumentFilter{status});
+}
+
+template <typename RankingPolicy, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query) const {
+    return FindTopDocuments<RankingPolicy>(policy, raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename RankingPolicy, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query, DocumentStatus status) const {
+    return FindTopDocuments<RankingPolicy>(policy, query, DocumentFilter{status});
+}
+
+template <typename RankingPolicy, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query) const {
+    return FindTopDocuments<RankingPolicy>(policy, query, DocumentStatus::ACTUAL);
+}
+
+template <typename RankingPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsWithAllWords(std::string_view raw_query, DocumentPredicate document_predicate) const {
+    return FindTopDocumentsWithAllWords<RankingPolicy>(raw_query, document_predicate, max_result_document_count_);
+}
+
+template <typename RankingPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsWithAllWords(std::string_view raw_query, DocumentPredicate document_predicate, size_t max_result_document_count) const {
+    QueryMetrics metrics;
+    const PreparedQuery query = [&] {
+        MetricsPhaseTimer timer(metrics.parse_time);
+        return PrepareQuery(raw_query);
+    }();
+    auto matched_documents = FindTopDocumentsWithAllWords<RankingPolicy>(query, document_predicate, max_result_document_count, metrics);
+    if constexpr (SEARCH_METRICS_ENABLED) {
+        RecordQueryMetrics(metrics);
+    }
+    return matched_documents;
+}
+
+template <typename RankingPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsWithAllWords(const PreparedQuery& query, DocumentPredicate document_predicate) const {
+    return FindTopDocumentsWithAllWords<RankingPolicy>(query, document_predicate, max_result_document_count_);
+}
+
+template <typename RankingPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsWithAllWords(const PreparedQuery& query, DocumentPredicate document_predicate, size_t max_result_document_count) const {
+    QueryMetrics metrics;
+    auto matched_documents = FindTopDocumentsWithAllWords<RankingPolicy>(query, document_predicate, max_result_document_count, metrics);
+    if constexpr (SEARCH_METRICS_ENABLED) {
+        RecordQueryMetrics(metrics);
+    }
+    return matched_documents;
+}
+
+template <typename RankingPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsWithAllWords(const PreparedQuery& prepared_query, DocumentPredicate document_predicate, size_t max_result_document_count, QueryMetrics& metrics) const {
+    PreparedQuery buffer;
+    const PreparedQuery& query = [&]() -> const PreparedQuery& {
+        MetricsPhaseTimer timer(metrics.parse_time);
+        return ResolveUnknownWords(prepared_query, buffer);
+    }();
+    auto matched_documents = [&] {
+        MetricsPhaseTimer timer(metrics.score_time);
+        return FindAllDocumentsWithAllWords<RankingPolicy>(query, document_predicate, metrics);
+    }();
+    if constexpr (SEARCH_METRICS_ENABLED) {
+        metrics.documents_matched += matched_documents.size();
+    }
+    MetricsPhaseTimer timer(metrics.sort_time);
+    SelectTopDocuments(matched_documents, max_result_document_count);
+    return matched_documents;
+}
+
+template <typename RankingPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocumentsWithAllWords(const PreparedQuery& query, DocumentPredicate document_predicate, QueryMetrics& metrics) const {
+    struct WordPostings {
+        const std::vector<Posting>* postings;
+        PostingIterator position;
+        double inverse_document_freq;
+    };
+
+    if (query.plus_words.empty() || !query.unknown_plus_words.empty()) {
+        return {};
+    }
+    const auto& idf_cache = GetInverseDocumentFreqCache<RankingPolicy>();
+    std::vector<double> inverse_document_freqs;
+    inverse_document_freqs.reserve(query.plus_words.size());
+    for (const WordId word_id : query.plus_words) {
+        if (GetPostingCount(word_id) == 0) {
+            return {};
+        }
+        inverse_document_freqs.push_back(ComputeWordInverseDocumentFreq(word_id, idf_cache));
+    }
+    // вклады слов складываются по возрастанию длины всего списка слова, одинаково для всех статусов:
+    // релевантность документа не зависит от того, как по статусам распределены другие документы
+    std::vector<size_t> summation_order(query.plus_words.size());
+    std::iota(summation_order.begin(), summation_order.end(), 0);
+    std::sort(summation_order.begin(), summation_order.end(), [this, &query](size_t lhs, size_t rhs) {
+        return GetPostingCount(query.plus_words[lhs]) < GetPostingCount(query.plus_words[rhs]);
+    });
+
+    const double average_document_length = ComputeAverageDocumentLength();
+    std::vector<Document> matched_documents;
+    std::vector<std::vector<Posting>> buffers(query.plus_words.size() + query.minus_words.size());
+    std::vector<WordPostings> plus_postings;
+    std::vector<WordPostings> minus_postings;
+    // у каждого слова документ лежит в участке своего статуса, поэтому участки пересекаются по статусам
+    for (size_t status_index = 0; status_index < DOCUMENT_STATUS_COUNT; ++status_index) {
+        const auto status = static_cast<DocumentStatus>(status_index);
+        if constexpr (std::is_same_v<DocumentPredicate, DocumentFilter>) {
+            if (status != document_predicate.status) {
+                continue;
+            }
+        }
+        plus_postings.clear();
+        for (size_t i = 0; i < query.plus_words.size(); ++i) {
+            if constexpr (std::is_same_v<DocumentPredicate, DocumentFilter>) {
+                if (!rating_ranges_[query.plus_words[i]][status_index].Intersects(document_predicate)) {
+                    break;
+                }
+            }
+            const auto& postings = GetPostings(query.plus_words[i], status, buffers[i]);
+            if (postings.empty()) {
+                break;
             }
+            plus_postings.push_back({&postings, postings.begin(), inverse_document_freqs[i]});
+        }
+        if (plus_postings.size() < query.plus_words.size()) {
+            continue;
+        }
+        minus_postings.clear();
+        for (size_t i = 0; i < query.minus_words.size(); ++i) {
+            const auto& postings = GetPostings(query.minus_words[i], status, buffers[query.plus_words.size() + i]);
+            minus_postings.push_back({&postings, postings.begin(), 0.0});
+        }
+        // кандидаты берутся из самого короткого участка, в остальных ищутся прыжками
+        const size_t candidate_index = std::min_element(plus_postings.begin(), plus_postings.end(),
+            [](const WordPostings& lhs, const WordPostings& rhs) {
+                return lhs.postings->size() < rhs.postings->size();
+            }) - plus_postings.begin();
+        const std::vector<Posting>& candidates = *plus_postings[candidate_index].postings;
+
+        bool has_candidates = true;
+        auto candidate_it = candidates.begin();
+        for (; has_candidates && candidate_it != candidates.end(); ++candidate_it) {
+            const Posting& candidate = *candidate_it;
+            if constexpr (std::is_same_v<DocumentPredicate, DocumentFilter>) {
+                if (!document_predicate(candidate.document_id, status, candidate.rating)) {
+                    continue;
+                }
+            }
+            const int document_id = candidate.document_id;
+            bool is_matched = true;
+            for (size_t i = 0; i < plus_postings.size() && is_matched; ++i) {
+                if (i == candidate_index) {
+                    continue;
+                }
+                auto& word_postings = plus_postings[i];
+                word_postings.position = GallopTo(word_postings.position, word_postings.postings->end(), document_id);
+                // один из участков закончился — дальше пересечение пустое
+                has_candidates = word_postings.position != word_postings.postings->end();
+                is_matched = has_candidates && word_postings.position->document_id == document_id;
+            }
+            for (size_t i = 0; i < minus_postings.size() && is_matched; ++i) {
+                auto& word_postings = minus_postings[i];
+                word_postings.position = GallopTo(word_postings.position, word_postings.postings->end(), document_id);
+                is_matched = word_postings.position == word_postings.postings->end() || word_postings.position->document_id != document_id;
+                if constexpr (SEARCH_METRICS_ENABLED) {
+                    if (!is_matched) {
+                        const auto& document_data = GetDocumentData(document_id);
+                        metrics.minus_word_removals += document_predicate(document_id, document_data.status, document_data.rating) ? 1 : 0;
+                    }
+                }
+            }
+            if (!is_matched) {
+                continue;
+            }
+            const auto& document_data = GetDocumentData(document_id);
+            if (!document_predicate(document_id, document_data.status, document_data.rating)) {
+                continue;
+            }
+            double relevance = 0.0;
+            for (const size_t i : summation_order) {
+                const double term_freq = i == candidate_index ? candidate.term_freq : plus_postings[i].position->term_freq;
+                relevance += RankingPolicy::ComputeTermRelevance(
+                    term_freq, document_data.word_count, average_document_length, plus_postings[i].inverse_document_freq);
+            }
+            matched_documents.push_back({document_id, relevance, document_data.rating});
+        }
+        if constexpr (SEARCH_METRICS_ENABLED) {
+            // в остальных участках просмотрены вхождения до места, куда дошёл поиск прыжками
+            for (size_t i = 0; i < plus_postings.size(); ++i) {
+                metrics.postings_scanned += i == candidate_index
+                    ? std::distance(candidates.begin(), candidate_it)
+                    : std::distance(plus_postings[i].postings->begin(), plus_postings[i].position);
+            }
+            for (const auto& word_postings : minus_postings) {
+                metrics.postings_scanned += std::distance(word_postings.postings->begin(), word_postings.position);
+            }
+        }
+    }
+    // документы разных статусов найдены по очереди; порядок по id — как у общего списка слова
+    if constexpr (!std::is_same_v<DocumentPredicate, DocumentFilter>) {
+        std::sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
+            return lhs.id < rhs.id;
         });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
     }
     return matched_documents;
 }
-    
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query,DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-    for (const std::string& word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
+
+template <typename RankingPolicy>
+std::vector<Document> SearchServer::FindTopDocumentsWithAllWords(std::string_view raw_query, DocumentStatus status) const {
+    return FindTopDocumentsWithAllWords<RankingPolicy>(raw_query, DocumentFilter{status});
+}
+
+template <typename RankingPolicy>
+std::vector<Document> SearchServer::FindTopDocumentsWithAllWords(std::string_view raw_query) const {
+    return FindTopDocumentsWithAllWords<RankingPolicy>(raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename RankingPolicy>
+std::vector<Document> SearchServer::FindTopDocumentsWithAllWords(const PreparedQuery& query, DocumentStatus status) const {
+    return FindTopDocumentsWithAllWords<RankingPolicy>(query, DocumentFilter{status});
+}
+
+template <typename RankingPolicy>
+std::vector<Document> SearchServer::FindTopDocumentsWithAllWords(const PreparedQuery& query) const {
+    return FindTopDocumentsWithAllWords<RankingPolicy>(query, DocumentStatus::ACTUAL);
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::RemoveDocument(ExecutionPolicy&& policy, int document_id) {
+    RemoveDocuments(policy, {document_id});
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::RemoveDocuments(ExecutionPolicy&& policy, const std::vector<int>& document_ids) {
+    std::vector<int> removed_ids;
+    // участки списков, из которых удаляются документы: пары (слово, статус)
+    std::vector<std::pair<WordId, size_t>> touched_runs;
+    for (const int document_id : document_ids) {
+        const auto document_it = documents_.find(document_id);
+        if (document_it == documents_.end()) {
             continue;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto &[document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+        removed_ids.push_back(document_id);
+        for (const auto& [word_id, _] : document_it->second.word_freqs) {
+            touched_runs.emplace_back(word_id, static_cast<size_t>(document_it->second.status));
+        }
+    }
+    if (removed_ids.empty()) {
+        return;
+    }
+    DecompressPostings();
+    std::sort(removed_ids.begin(), removed_ids.end());
+    std::sort(touched_runs.begin(), touched_runs.end());
+    touched_runs.erase(std::unique(touched_runs.begin(), touched_runs.end()), touched_runs.end());
+
+    // у разных участков свои вектора, поэтому их можно чистить независимо
+    std::for_each(policy, touched_runs.begin(), touched_runs.end(),
+        [this, &removed_ids](const std::pair<WordId, size_t>& run) {
+            auto& postings = word_postings_[run.first][run.second];
+            postings.erase(std::remove_if(postings.begin(), postings.end(),
+                [&removed_ids](const Posting& posting) {
+                    return std::binary_search(removed_ids.begin(), removed_ids.end(), posting.document_id);
+                }), postings.end());
+            // удалённый документ мог задавать границу рейтинга, поэтому границы считаются заново
+            RatingRange rating_range;
+            for (const Posting& posting : postings) {
+                rating_range.Add(posting.rating);
+            }
+            rating_ranges_[run.first][run.second] = rating_range;
+            InvalidateInverseDocumentFreq(run.first);
+        });
+
+    for (const int document_id : removed_ids) {
+        const auto document_it = documents_.find(document_id);
+        total_word_count_ -= document_it->second.word_count;
+        documents_.erase(document_it);
+        document_ids_.erase(document_id);
+        UpdateDocumentLookup(document_id);
+    }
+}
+
+template <typename ExecutionPolicy>
+void SearchServer::AddDocuments(ExecutionPolicy&& policy, const std::vector<RawDocument>& documents) {
+    struct ParsedDocument {
+        std::vector<std::pair<std::string_view, int>> word_counts;
+        int word_count = 0;
+        int rating = 0;
+        std::exception_ptr error;
+    };
+
+    std::vector<const RawDocument*> sorted_documents;
+    sorted_documents.reserve(documents.size());
+    for (const RawDocument& document : documents) {
+        if ((document.id < 0) || (documents_.count(document.id) > 0)) {
+            throw std::invalid_argument("Invalid document_id");
+        }
+        sorted_documents.push_back(&document);
+    }
+    std::sort(sorted_documents.begin(), sorted_documents.end(),
+        [](const RawDocument* lhs, const RawDocument* rhs) {
+            return lhs->id < rhs->id;
+        });
+    if (std::adjacent_find(sorted_documents.begin(), sorted_documents.end(),
+            [](const RawDocument* lhs, const RawDocument* rhs) {
+                return lhs->id == rhs->id;
+            }) != sorted_documents.end()) {
+        throw std::invalid_argument("Invalid document_id");
+    }
+
+    // исключение внутри параллельного алгоритма вызывает std::terminate, поэтому ошибки сохраняются
+    std::vector<ParsedDocument> parsed_documents(sorted_documents.size());
+    std::transform(policy, sorted_documents.begin(), sorted_documents.end(), parsed_documents.begin(),
+        [this](const RawDocument* document) {
+            ParsedDocument parsed;
+            try {
+                auto words = SplitIntoWordsNoStop(document->text, stop_words_);
+                parsed.word_count = static_cast<int>(words.size());
+                parsed.rating = ComputeAverageRating(document->ratings);
+                std::sort(words.begin(), words.end());
+                for (std::string_view word : words) {
+                    if (parsed.word_counts.empty() || parsed.word_counts.back().first != word) {
+                        parsed.word_counts.emplace_back(word, 0);
+                    }
+                    ++parsed.word_counts.back().second;
+                }
+            } catch (...) {
+                parsed.error = std::current_exception();
             }
+            return parsed;
+        });
+    for (const ParsedDocument& parsed : parsed_documents) {
+        if (parsed.error) {
+            std::rethrow_exception(parsed.error);
         }
     }
-    
-    for (const std::string& word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+
+    // каждый кусок подряд идущих id строит свой частичный индекс, списки в нём уже отсортированы
+    const size_t chunk_count = std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>
+        ? 1
+        : std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), parsed_documents.size()));
+    std::vector<std::unordered_map<std::string_view, StatusPostings>> partial_indices(chunk_count);
+    std::vector<size_t> chunk_indices(chunk_count);
+    for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+        chunk_indices[chunk] = chunk;
+    }
+    std::for_each(policy, chunk_indices.begin(), chunk_indices.end(),
+        [&](size_t chunk) {
+            const size_t first = parsed_documents.size() * chunk / chunk_count;
+            const size_t last = parsed_documents.size() * (chunk + 1) / chunk_count;
+            auto& partial_index = partial_indices[chunk];
+            for (size_t i = first; i < last; ++i) {
+                const auto& parsed = parsed_documents[i];
+                const auto status = static_cast<size_t>(sorted_documents[i]->status);
+                for (const auto& [word, term_count] : parsed.word_counts) {
+                    partial_index[word][status].push_back({sorted_documents[i]->id, parsed.rating, term_count / static_cast<double>(parsed.word_count)});
+                }
+            }
+        });
+
+    DecompressPostings();
+    // для каждого участка (слово, статус) — его длина до вставки: новые вхождения дописаны после неё
+    struct TouchedRun {
+        WordId word_id;
+        size_t status;
+        size_t old_size;
+    };
+    std::vector<TouchedRun> touched_runs;
+    for (auto& partial_index : partial_indices) {
+        for (auto& [word, word_postings] : partial_index) {
+            const WordId word_id = GetOrAddWordId(word);
+            for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+                if (word_postings[status].empty()) {
+                    continue;
+                }
+                auto& postings = word_postings_[word_id][status];
+                touched_runs.push_back({word_id, status, postings.size()});
+                postings.insert(postings.end(), word_postings[status].begin(), word_postings[status].end());
+                for (const Posting& posting : word_postings[status]) {
+                    rating_ranges_[word_id][status].Add(posting.rating);
+                }
+            }
+            InvalidateInverseDocumentFreq(word_id);
+        }
+    }
+    std::vector<std::unordered_map<std::string_view, StatusPostings>>().swap(partial_indices);
+
+    // старые вхождения участка могут иметь id больше новых; после сортировки первой идёт запись
+    // с исходным размером участка
+    std::sort(touched_runs.begin(), touched_runs.end(),
+        [](const TouchedRun& lhs, const TouchedRun& rhs) {
+            return std::tie(lhs.word_id, lhs.status, lhs.old_size) < std::tie(rhs.word_id, rhs.status, rhs.old_size);
+        });
+    touched_runs.erase(std::unique(touched_runs.begin(), touched_runs.end(),
+        [](const TouchedRun& lhs, const TouchedRun& rhs) {
+            return lhs.word_id == rhs.word_id && lhs.status == rhs.status;
+        }), touched_runs.end());
+    std::for_each(policy, touched_runs.begin(), touched_runs.end(),
+        [this](const TouchedRun& touched_run) {
+            auto& postings = word_postings_[touched_run.word_id][touched_run.status];
+            const auto middle = postings.begin() + touched_run.old_size;
+            if (middle != postings.begin() && middle != postings.end() && std::prev(middle)->document_id > middle->document_id) {
+                std::inplace_merge(postings.begin(), middle, postings.end(),
+                    [](const Posting& lhs, const Posting& rhs) {
+                        return lhs.document_id < rhs.document_id;
+                    });
+            }
+        });
+
+    std::vector<DocumentData> documents_data(parsed_documents.size());
+    std::transform(policy, sorted_documents.begin(), sorted_documents.end(), parsed_documents.begin(), documents_data.begin(),
+        [this](const RawDocument* document, const ParsedDocument& parsed) {
+            DocumentData document_data{parsed.rating, document->status, parsed.word_count, {}};
+            document_data.word_freqs.reserve(parsed.word_counts.size());
+            for (const auto& [word, term_count] : parsed.word_counts) {
+                document_data.word_freqs.emplace_back(*FindWordId(word), term_count / static_cast<double>(parsed.word_count));
+            }
+            std::sort(document_data.word_freqs.begin(), document_data.word_freqs.end());
+            return document_data;
+        });
+    for (size_t i = 0; i < sorted_documents.size(); ++i) {
+        total_word_count_ += documents_data[i].word_count;
+        documents_.emplace(sorted_documents[i]->id, std::move(documents_data[i]));
+        UpdateDocumentLookup(sorted_documents[i]->id);
+        document_ids_.insert(sorted_documents[i]->id);
+    }
+}
+
+template <typename RankingPolicy>
+const SearchServer::InverseDocumentFreqCache& SearchServer::GetInverseDocumentFreqCache() const {
+    return GetInverseDocumentFreqCache(&RankingPolicy::ComputeInverseDocumentFreq);
+}
+
+template <typename RankingPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(const std::execution::sequenced_policy&, const PreparedQuery& query, DocumentPredicate document_predicate, QueryMetrics& metrics) const {
+    const double average_document_length = ComputeAverageDocumentLength();
+    const auto& idf_cache = GetInverseDocumentFreqCache<RankingPolicy>();
+    if (AreDocumentIdsDense()) {
+        // стоимость пропорциональна числу просмотренных вхождений, предикат вызывается раз на документ
+        using State = RelevanceAccumulator::State;
+        auto& accumulator = GetThreadRelevanceAccumulator();
+        const RelevanceAccumulatorGuard accumulator_guard(accumulator);
+        if (accumulator.states.size() < document_lookup_.size()) {
+            accumulator.relevances.resize(document_lookup_.size(), 0.0);
+            accumulator.states.resize(document_lookup_.size(), State::UNTOUCHED);
+        }
+        auto& [relevances, states, touched_document_ids] = accumulator;
+
+        for (const WordId word_id : query.minus_words) {
+            ForEachDocumentId(word_id, document_predicate, [&states, &touched_document_ids](int document_id) {
+                if (states[document_id] == State::UNTOUCHED) {
+                    // сначала в список: если push_back бросит, состояние останется нетронутым
+                    touched_document_ids.push_back(document_id);
+                    states[document_id] = State::EXCLUDED;
+                }
+            });
         }
-        for (const auto &[document_id, _] : word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
+        for (const WordId word_id : query.plus_words) {
+            if (GetPostingCount(word_id) == 0) {
+                continue;
+            }
+            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word_id, idf_cache);
+            ForEachPosting(word_id, document_predicate, [&](int document_id, double term_freq, const DocumentData& document_data) {
+                auto& state = states[document_id];
+                if (state == State::UNTOUCHED) {
+                    const bool accepted = document_predicate(document_id, document_data.status, document_data.rating);
+                    touched_document_ids.push_back(document_id);
+                    state = accepted ? State::ACCEPTED : State::REJECTED;
+                }
+                if (state == State::ACCEPTED) {
+                    relevances[document_id] += RankingPolicy::ComputeTermRelevance(
+                        term_freq, document_data.word_count, average_document_length, inverse_document_freq);
+                } else if constexpr (SEARCH_METRICS_ENABLED) {
+                    if (state == State::EXCLUDED) {
+                        metrics.minus_word_removals += document_predicate(document_id, document_data.status, document_data.rating) ? 1 : 0;
+                        state = State::REJECTED;
+                    }
+                }
+            });
         }
+
+        std::vector<Document> matched_documents;
+        for (const int document_id : touched_document_ids) {
+            if (states[document_id] == State::ACCEPTED) {
+                matched_documents.push_back({document_id, relevances[document_id], document_lookup_[document_id]->rating});
+            }
+        }
+        return matched_documents;
+    }
+
+    std::map<int, double> document_to_relevance;
+    for (const WordId word_id : query.plus_words) {
+        if (GetPostingCount(word_id) == 0) {
+            continue;
+        }
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word_id, idf_cache);
+        ForEachPosting(word_id, document_predicate, [&](int document_id, double term_freq, const DocumentData& document_data) {
+            if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                document_to_relevance[document_id] += RankingPolicy::ComputeTermRelevance(
+                    term_freq, document_data.word_count, average_document_length, inverse_document_freq);
+            }
+        });
     }
     
+    for (const WordId word_id : query.minus_words) {
+        ForEachDocumentId(word_id, document_predicate, [&document_to_relevance, &metrics](int document_id) {
+            const size_t removed_count = document_to_relevance.erase(document_id);
+            if constexpr (SEARCH_METRICS_ENABLED) {
+                metrics.minus_word_removals += removed_count;
+            }
+        });
+    }
+    
+    return BuildMatchedDocuments(document_to_relevance);
+}
+
+template <typename RankingPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy& policy, const PreparedQuery& query, DocumentPredicate document_predicate, QueryMetrics& metrics) const {
+    using WordContributions = std::vector<std::pair<int, double>>;
+    const double average_document_length = ComputeAverageDocumentLength();
+    const auto& idf_cache = GetInverseDocumentFreqCache<RankingPolicy>();
+    // вклады слов считаются параллельно, а складываются в порядке plus_words, как в последовательной версии:
+    // порядок сложения чисел с плавающей точкой не зависит от потоков, и релевантность совпадает до бита
+    std::vector<WordContributions> word_contributions(query.plus_words.size());
+    std::transform(policy, query.plus_words.begin(), query.plus_words.end(), word_contributions.begin(),
+        [this, &document_predicate, &idf_cache, average_document_length](WordId word_id) {
+            WordContributions contributions;
+            if (GetPostingCount(word_id) == 0) {
+                return contributions;
+            }
+            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word_id, idf_cache);
+            ForEachPosting(word_id, document_predicate, [&](int document_id, double term_freq, const DocumentData& document_data) {
+                if (document_predicate(document_id, document_data.status, document_data.rating)) {
+                    contributions.emplace_back(document_id, RankingPolicy::ComputeTermRelevance(
+                        term_freq, document_data.word_count, average_document_length, inverse_document_freq));
+                }
+            });
+            return contributions;
+        });
+
+    std::vector<std::vector<int>> minus_word_document_ids(query.minus_words.size());
+    std::transform(policy, query.minus_words.begin(), query.minus_words.end(), minus_word_document_ids.begin(),
+        [this, &document_predicate](WordId word_id) {
+            std::vector<int> document_ids;
+            document_ids.reserve(GetPostingCount(word_id));
+            ForEachDocumentId(word_id, document_predicate, [&document_ids](int document_id) {
+                document_ids.push_back(document_id);
+            });
+            return document_ids;
+        });
+    std::vector<int> excluded_document_ids;
+    for (const auto& document_ids : minus_word_document_ids) {
+        excluded_document_ids.insert(excluded_document_ids.end(), document_ids.begin(), document_ids.end());
+    }
+    std::sort(excluded_document_ids.begin(), excluded_document_ids.end());
+
+    struct MatchedDocument {
+        Document document;
+        // первое плюс-слово, в котором встретился документ
+        size_t first_word_index;
+    };
+
+    // вклады упорядочены по id документа, поэтому диапазоны id складываются независимо друг от друга
+    const int64_t max_document_id = documents_.empty() ? 0 : documents_.rbegin()->first;
+    const int64_t range_size = max_document_id / static_cast<int64_t>(RELEVANCE_BUCKET_COUNT) + 1;
+    std::vector<std::vector<MatchedDocument>> range_documents(RELEVANCE_BUCKET_COUNT);
+    std::vector<size_t> ranges(RELEVANCE_BUCKET_COUNT);
+    std::iota(ranges.begin(), ranges.end(), 0);
+    std::atomic<uint64_t> minus_word_removals = 0;
+    std::for_each(policy, ranges.begin(), ranges.end(),
+        [&](size_t range) {
+            const int64_t first_id = range * range_size;
+            const int64_t last_id = first_id + range_size;
+            std::map<int, std::pair<double, size_t>> document_to_relevance;
+            for (size_t word_index = 0; word_index < word_contributions.size(); ++word_index) {
+                const auto& contributions = word_contributions[word_index];
+                auto it = std::lower_bound(contributions.begin(), contributions.end(), first_id,
+                    [](const std::pair<int, double>& contribution, int64_t document_id) {
+                        return contribution.first < document_id;
+                    });
+                for (; it != contributions.end() && it->first < last_id; ++it) {
+                    auto [relevance_it, _] = document_to_relevance.try_emplace(it->first, 0.0, word_index);
+                    relevance_it->second.first += it->second;
+                }
+            }
+            uint64_t removed_count = 0;
+            for (const auto& [document_id, relevance] : document_to_relevance) {
+                if (std::binary_search(excluded_document_ids.begin(), excluded_document_ids.end(), document_id)) {
+                    ++removed_count;
+                    continue;
+                }
+                range_documents[range].push_back({{document_id, relevance.first, GetDocumentData(document_id).rating}, relevance.second});
+            }
+            if constexpr (SEARCH_METRICS_ENABLED) {
+                minus_word_removals.fetch_add(removed_count, std::memory_order_relaxed);
+            }
+        });
+    if constexpr (SEARCH_METRICS_ENABLED) {
+        metrics.minus_word_removals += minus_word_removals.load(std::memory_order_relaxed);
+    }
+
+    std::vector<MatchedDocument> ordered_documents;
+    for (const auto& documents : range_documents) {
+        ordered_documents.insert(ordered_documents.end(), documents.begin(), documents.end());
+    }
+    // порядок как у последовательной версии: при плотных id документы идут в порядке первого
+    // вхождения по плюс-словам, иначе по возрастанию id
+    if (AreDocumentIdsDense()) {
+        std::stable_sort(ordered_documents.begin(), ordered_documents.end(),
+            [](const MatchedDocument& lhs, const MatchedDocument& rhs) {
+                return lhs.first_word_index < rhs.first_word_index;
+            });
+    }
     std::vector<Document> matched_documents;
-    for (const auto &[document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+    matched_documents.reserve(ordered_documents.size());
+    for (const auto& matched : ordered_documents) {
+        matched_documents.push_back(matched.document);
     }
     return matched_documents;
 }
+
+template <typename Function>
+void SearchServer::ForEachPosting(WordId word_id, Function function) const {
+    size_t run_count = 0;
+    DocumentStatus single_status = DocumentStatus::ACTUAL;
+    for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+        if (GetPostingCount(word_id, static_cast<DocumentStatus>(status)) > 0) {
+            ++run_count;
+            single_status = static_cast<DocumentStatus>(status);
+        }
+    }
+    if (run_count <= 1) {
+        ForEachStatusPosting(word_id, single_status, function);
+        return;
+    }
+
+    // на каждом шаге берётся вхождение с наименьшим id среди текущих вхождений участков
+    if (postings_compressed_) {
+        std::array<CompressedPostingList::Reader, DOCUMENT_STATUS_COUNT> readers;
+        for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+            readers[status] = CompressedPostingList::Reader(compressed_postings_[word_id][status]);
+        }
+        while (true) {
+            size_t next = DOCUMENT_STATUS_COUNT;
+            for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+                if (!readers[status].AtEnd() && (next == DOCUMENT_STATUS_COUNT || readers[status].GetDocumentId() < readers[next].GetDocumentId())) {
+                    next = status;
+                }
+            }
+            if (next == DOCUMENT_STATUS_COUNT) {
+                break;
+            }
+            const int document_id = readers[next].GetDocumentId();
+            const auto& document_data = GetDocumentData(document_id);
+            function(document_id, readers[next].GetTermCount() / static_cast<double>(document_data.word_count), document_data);
+            readers[next].Next();
+        }
+    } else {
+        std::array<PostingIterator, DOCUMENT_STATUS_COUNT> positions;
+        std::array<PostingIterator, DOCUMENT_STATUS_COUNT> ends;
+        for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+            positions[status] = word_postings_[word_id][status].begin();
+            ends[status] = word_postings_[word_id][status].end();
+        }
+        while (true) {
+            size_t next = DOCUMENT_STATUS_COUNT;
+            for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+                if (positions[status] != ends[status] && (next == DOCUMENT_STATUS_COUNT || positions[status]->document_id < positions[next]->document_id)) {
+                    next = status;
+                }
+            }
+            if (next == DOCUMENT_STATUS_COUNT) {
+                break;
+            }
+            const Posting& posting = *positions[next]++;
+            function(posting.document_id, posting.term_freq, GetDocumentData(posting.document_id));
+        }
+    }
+}
+
+template <typename Function>
+void SearchServer::ForEachStatusPosting(WordId word_id, DocumentStatus status, Function function) const {
+    const auto status_index = static_cast<size_t>(status);
+    if (postings_compressed_) {
+        // в сжатом списке хранится число вхождений слова, TF восстанавливается по длине документа
+        compressed_postings_[word_id][status_index].ForEach([this, &function](int document_id, int term_count) {
+            const auto& document_data = GetDocumentData(document_id);
+            function(document_id, term_count / static_cast<double>(document_data.word_count), document_data);
+        });
+    } else {
+        for (const auto& [document_id, _, term_freq] : word_postings_[word_id][status_index]) {
+            function(document_id, term_freq, GetDocumentData(document_id));
+        }
+    }
+}
+
+template <typename DocumentPredicate, typename Function>
+void SearchServer::ForEachPosting(WordId word_id, const DocumentPredicate& document_predicate, Function function) const {
+    if constexpr (std::is_same_v<DocumentPredicate, DocumentFilter>) {
+        const DocumentStatus status = document_predicate.status;
+        const RatingRange& rating_range = rating_ranges_[word_id][static_cast<size_t>(status)];
+        if (!rating_range.Intersects(document_predicate)) {
+            return;
+        }
+        if (!postings_compressed_ && !rating_range.IsWithin(document_predicate)) {
+            for (const auto& [document_id, rating, term_freq] : word_postings_[word_id][static_cast<size_t>(status)]) {
+                if (document_predicate(document_id, status, rating)) {
+                    function(document_id, term_freq, GetDocumentData(document_id));
+                }
+            }
+            return;
+        }
+        ForEachStatusPosting(word_id, status, function);
+    } else {
+        ForEachPosting(word_id, function);
+    }
+}
+
+template <typename DocumentPredicate, typename Function>
+void SearchServer::ForEachDocumentId(WordId word_id, const DocumentPredicate& document_predicate, Function function) const {
+    for (size_t status = 0; status < DOCUMENT_STATUS_COUNT; ++status) {
+        if constexpr (std::is_same_v<DocumentPredicate, DocumentFilter>) {
+            if (static_cast<DocumentStatus>(status) != document_predicate.status) {
+                continue;
+            }
+        }
+        if (postings_compressed_) {
+            compressed_postings_[word_id][status].ForEach([&function](int document_id, int) {
+                function(document_id);
+            });
+        } else {
+            for (const auto& posting : word_postings_[word_id][status]) {
+                function(posting.document_id);
+            }
+        }
+    }
+}
+
+template <typename DocumentPredicate>
+uint64_t SearchServer::CountQueryPostings(const PreparedQuery& query, const DocumentPredicate& document_predicate) const {
+    // участки плюс- и минус-слов считаются целиком, в том числе пропущенные по рейтингу
+    uint64_t posting_count = 0;
+    for (const auto* word_ids : {&query.plus_words, &query.minus_words}) {
+        for (const WordId word_id : *word_ids) {
+            if constexpr (std::is_same_v<DocumentPredicate, DocumentFilter>) {
+                posting_count += GetPostingCount(word_id, document_predicate.status);
+            } else {
+                posting_count += GetPostingCount(word_id);
+            }
+        }
+    }
+    return posting_count;
+}
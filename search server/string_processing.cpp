@@ -1,20 +1,207 @@
 #include "string_processing.h"
 
-std::vector<std::string> SplitIntoWords(const std::string& text) {
-    std::vector<std::string> words;
-    std::string word;
-    for (const char c : text) {
-        if (c == ' ') {
-            if (!word.empty()) {
-                words.push_back(word);
-                word.clear();
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+struct QueryWord {
+    std::string_view data;
+    bool is_minus;
+    bool is_stop;
+};
+
+QueryWord ParseQueryWord(std::string_view text, const std::set<std::string, std::less<>>& stop_words, bool check_valid) {
+    if (text.empty()) {
+        throw std::invalid_argument("Query word is empty");
+    }
+    std::string_view word = text;
+    bool is_minus = false;
+    if (word[0] == '-') {
+        is_minus = true;
+        word.remove_prefix(1);
+    }
+    if (word.empty() || word[0] == '-' || (check_valid && !IsValidWord(word))) {
+        throw std::invalid_argument("Query word " + std::string(text) + " is invalid");
+    }
+    
+    return {word, is_minus, stop_words.count(word) > 0};
+}
+
+void RemoveDuplicateWords(std::vector<std::string_view>& words) {
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+}
+
+// Биты пробелов и управляющих символов в блоке текста: бит i соответствует символу i
+struct BlockMasks {
+    uint64_t spaces;
+    uint64_t controls;
+};
+
+bool IsControlChar(char c) {
+    return c >= '\0' && c < ' ';
+}
+
+BlockMasks ComputeMasksScalar(const char* data, size_t size) {
+    BlockMasks masks{0, 0};
+    for (size_t i = 0; i < size; ++i) {
+        masks.spaces |= static_cast<uint64_t>(data[i] == ' ') << i;
+        masks.controls |= static_cast<uint64_t>(IsControlChar(data[i])) << i;
+    }
+    return masks;
+}
+
+#if defined(__AVX2__)
+
+const size_t BLOCK_SIZE = 32;
+
+BlockMasks ComputeBlockMasks(const char* data) {
+    const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    const __m256i spaces = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' '));
+    // символы со знаковым кодом из [0, 32)
+    const __m256i controls = _mm256_andnot_si256(_mm256_cmpgt_epi8(_mm256_setzero_si256(), block),
+                                                 _mm256_cmpgt_epi8(_mm256_set1_epi8(' '), block));
+    return {static_cast<uint32_t>(_mm256_movemask_epi8(spaces)), static_cast<uint32_t>(_mm256_movemask_epi8(controls))};
+}
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+const size_t BLOCK_SIZE = 16;
+
+BlockMasks ComputeBlockMasks(const char* data) {
+    const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    const __m128i spaces = _mm_cmpeq_epi8(block, _mm_set1_epi8(' '));
+    // символы со знаковым кодом из [0, 32)
+    const __m128i controls = _mm_andnot_si128(_mm_cmplt_epi8(block, _mm_setzero_si128()),
+                                              _mm_cmplt_epi8(block, _mm_set1_epi8(' ')));
+    return {static_cast<uint32_t>(_mm_movemask_epi8(spaces)), static_cast<uint32_t>(_mm_movemask_epi8(controls))};
+}
+
+#else
+
+const size_t BLOCK_SIZE = 8;
+
+BlockMasks ComputeBlockMasks(const char* data) {
+    return ComputeMasksScalar(data, BLOCK_SIZE);
+}
+
+#endif
+
+int CountTrailingZeros(uint64_t value) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(value);
+#else
+    int count = 0;
+    while ((value & 1) == 0) {
+        value >>= 1;
+        ++count;
+    }
+    return count;
+#endif
+}
+
+// Делит текст на слова по пробелам, за один проход ищет управляющие символы.
+// Возвращает позицию первого управляющего символа или npos.
+size_t TokenizeWords(std::string_view text, std::vector<std::string_view>& words) {
+    size_t first_control = std::string_view::npos;
+    size_t word_begin = std::string_view::npos;
+    for (size_t offset = 0; offset < text.size(); offset += BLOCK_SIZE) {
+        const size_t block_size = std::min(BLOCK_SIZE, text.size() - offset);
+        const BlockMasks masks = block_size == BLOCK_SIZE
+            ? ComputeBlockMasks(text.data() + offset)
+            : ComputeMasksScalar(text.data() + offset, block_size);
+        if (masks.controls != 0 && first_control == std::string_view::npos) {
+            first_control = offset + CountTrailingZeros(masks.controls);
+        }
+        const uint64_t block_bits = block_size == 64 ? ~uint64_t{0} : (uint64_t{1} << block_size) - 1;
+        uint64_t word_bits = ~masks.spaces & block_bits;
+        uint64_t space_bits = masks.spaces;
+        // поочерёдно ищем начало слова среди непробелов и его конец среди пробелов
+        while (true) {
+            if (word_begin == std::string_view::npos) {
+                if (word_bits == 0) {
+                    break;
+                }
+                const int position = CountTrailingZeros(word_bits);
+                word_begin = offset + position;
+                space_bits &= ~uint64_t{0} << position;
+            } else {
+                if (space_bits == 0) {
+                    break;
+                }
+                const int position = CountTrailingZeros(space_bits);
+                words.push_back(text.substr(word_begin, offset + position - word_begin));
+                word_begin = std::string_view::npos;
+                word_bits &= ~uint64_t{0} << position;
             }
-        } else {
-            word += c;
         }
     }
-    if (!word.empty()) {
-        words.push_back(word);
+    if (word_begin != std::string_view::npos) {
+        words.push_back(text.substr(word_begin));
     }
+    return first_control;
+}
+
+}  // namespace
+
+std::vector<std::string_view> SplitIntoWords(std::string_view text) {
+    std::vector<std::string_view> words;
+    TokenizeWords(text, words);
     return words;
 }
+
+bool IsValidWord(std::string_view word) {
+    return std::none_of(word.begin(), word.end(), [](char c) {
+            return IsControlChar(c);
+    });
+}
+
+std::vector<std::string_view> SplitIntoValidWords(std::string_view text) {
+    std::vector<std::string_view> words;
+    const size_t first_control = TokenizeWords(text, words);
+    if (first_control != std::string_view::npos) {
+        const auto invalid_word = std::find_if(words.begin(), words.end(), [&text, first_control](std::string_view word) {
+            return static_cast<size_t>(word.data() - text.data()) + word.size() > first_control;
+        });
+        throw std::invalid_argument("Word " + std::string(*invalid_word) + " is invalid");
+    }
+    return words;
+}
+
+std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text, const std::set<std::string, std::less<>>& stop_words) {
+    auto words = SplitIntoValidWords(text);
+    if (!stop_words.empty()) {
+        words.erase(std::remove_if(words.begin(), words.end(), [&stop_words](std::string_view word) {
+            return stop_words.count(word) > 0;
+        }), words.end());
+    }
+    return words;
+}
+
+Query ParseQuery(std::string_view text, const std::set<std::string, std::less<>>& stop_words, bool remove_duplicates) {
+    Query result;
+    std::vector<std::string_view> words;
+    const bool has_control_chars = TokenizeWords(text, words) != std::string_view::npos;
+    for (std::string_view word : words) {
+        const auto query_word = ParseQueryWord(word, stop_words, has_control_chars);
+        if (!query_word.is_stop) {
+            if (query_word.is_minus) {
+                result.minus_words.push_back(query_word.data);
+            } else {
+                result.plus_words.push_back(query_word.data);
+            }
+        }
+    }
+    if (remove_duplicates) {
+        RemoveDuplicateWords(result.plus_words);
+        RemoveDuplicateWords(result.minus_words);
+    }
+
+    return result;
+}
@@ -2,16 +2,30 @@
 
 #include <set>
 #include <string>
+#include <string_view>
 #include <vector>
 
-std::vector<std::string> SplitIntoWords(const std::string& text);
+struct Query {
+    std::vector<std::string_view> plus_words;
+    std::vector<std::string_view> minus_words;
+};
+
+std::vector<std::string_view> SplitIntoWords(std::string_view text);
+
+bool IsValidWord(std::string_view word);
+
+std::vector<std::string_view> SplitIntoValidWords(std::string_view text);
+
+std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text, const std::set<std::string, std::less<>>& stop_words);
+
+Query ParseQuery(std::string_view text, const std::set<std::string, std::less<>>& stop_words, bool remove_duplicates = true);
 
 template <typename StringContainer>
-std::set<std::string> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
-    std::set<std::string> non_empty_strings;
-    for (const std::string& str : strings) {
-        if (!str.empty()) {
-            non_empty_strings.insert(str);
+std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
+    std::set<std::string, std::less<>> non_empty_strings;
+    for (const auto& str : strings) {
+        if (!std::string_view(str).empty()) {
+            non_empty_strings.emplace(str);
         }
     }
     
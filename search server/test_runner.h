@@ -0,0 +1,62 @@
+#pragma once
+
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+template <typename T, typename U>
+void AssertEqual(const T& t, const U& u, const std::string& hint = {}) {
+    if (!(t == u)) {
+        std::ostringstream out;
+        out << "Assertion failed: " << t << " != " << u;
+        if (!hint.empty()) {
+            out << " hint: " << hint;
+        }
+        throw std::runtime_error(out.str());
+    }
+}
+
+inline void Assert(bool value, const std::string& hint) {
+    AssertEqual(value, true, hint);
+}
+
+class TestRunner {
+public:
+    template <typename TestFunction>
+    void RunTest(TestFunction function, const std::string& test_name) {
+        try {
+            function();
+            std::cerr << test_name << " OK" << std::endl;
+        } catch (const std::exception& error) {
+            ++fail_count_;
+            std::cerr << test_name << " fail: " << error.what() << std::endl;
+        } catch (...) {
+            ++fail_count_;
+            std::cerr << "Unknown exception caught in " << test_name << std::endl;
+        }
+    }
+
+    int GetFailCount() const {
+        return fail_count_;
+    }
+
+private:
+    int fail_count_ = 0;
+};
+
+#define ASSERT_EQUAL(x, y) {                                            \
+    std::ostringstream assert_equal_hint;                               \
+    assert_equal_hint << #x << " != " << #y << ", "                     \
+        << __FILE__ << ":" << __LINE__;                                 \
+    AssertEqual(x, y, assert_equal_hint.str());                         \
+}
+
+#define ASSERT(x) {                                                     \
+    std::ostringstream assert_hint;                                     \
+    assert_hint << #x << " is false, " << __FILE__ << ":" << __LINE__;  \
+    Assert(static_cast<bool>(x), assert_hint.str());                    \
+}
+
+#define RUN_TEST(tr, func) \
+    tr.RunTest(func, #func)
@@ -0,0 +1,853 @@
+// Юнит-тесты SearchServer. Сборка: см. раздел «Тесты» в README.md.
+
+#include "../concurrent_search_server.h"
+#include "../corpus_loader.h"
+#include "../paginator.h"
+#include "../prepared_query_cache.h"
+#include "../query_result_cache.h"
+#include "../remove_duplicates.h"
+#include "../request_queue.h"
+#include "../search_server.h"
+#include "../string_processing.h"
+#include "../test_runner.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+// Документы с id из skipped_ids генерируются, но не добавляются: остальные документы те же
+SearchServer MakeRandomServer(int document_count, int vocabulary_size, int document_length, const set<int>& skipped_ids = {}) {
+    mt19937 generator(17);
+    uniform_int_distribution<int> word_distribution(0, vocabulary_size - 1);
+    SearchServer search_server("and in"s);
+    for (int document_id = 0; document_id < document_count; ++document_id) {
+        string document;
+        for (int i = 0; i < document_length; ++i) {
+            document += "w"s + to_string(word_distribution(generator)) + " "s;
+        }
+        if (skipped_ids.count(document_id) == 0) {
+            search_server.AddDocument(document_id, document, DocumentStatus::ACTUAL, {document_id % 7});
+        }
+    }
+    return search_server;
+}
+
+void AssertSameDocuments(const vector<Document>& expected, const vector<Document>& actual) {
+    ASSERT_EQUAL(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQUAL(expected[i].id, actual[i].id);
+        // сравнение точное: суммы должны совпадать до бита
+        ASSERT(expected[i].relevance == actual[i].relevance);
+        ASSERT_EQUAL(expected[i].rating, actual[i].rating);
+    }
+}
+
+void TestParallelRelevanceMatchesSequential() {
+    SearchServer search_server = MakeRandomServer(3'000, 40, 30);
+    const size_t result_count = 3'000;
+    const auto even_rating = [](int, DocumentStatus, int rating) {
+        return rating % 2 == 0;
+    };
+    // второй проход — с разреженными id, когда последовательный поиск накапливает релевантность в map
+    for (const bool sparse_ids : {false, true}) {
+        if (sparse_ids) {
+            search_server.AddDocument(1'000'000, "w1 w2 w3 w17"s, DocumentStatus::ACTUAL, {4});
+        }
+        for (const string& query : {"w1 w2 w3 w4 w5 w6 w7"s, "w0 w9 w13 w21 -w5"s, "w3 w3 w17 w30 w31 w39"s}) {
+            const auto sequential = search_server.FindTopDocuments(execution::seq, query, DocumentFilter{}, result_count);
+            ASSERT(sequential.size() > MAX_RESULT_DOCUMENT_COUNT);
+            AssertSameDocuments(sequential, search_server.FindTopDocuments(execution::par, query, DocumentFilter{}, result_count));
+            AssertSameDocuments(search_server.FindTopDocuments(execution::seq, query, even_rating, result_count),
+                                search_server.FindTopDocuments(execution::par, query, even_rating, result_count));
+        }
+    }
+}
+
+void TestDocumentFilterMatchesPredicate() {
+    mt19937 generator(23);
+    SearchServer search_server("and in"s);
+    const auto add_random_document = [&](int document_id) {
+        string document;
+        for (int i = 0; i < 8; ++i) {
+            document += "w"s + to_string(generator() % 30) + " "s;
+        }
+        search_server.AddDocument(document_id, document, static_cast<DocumentStatus>(generator() % 4), {static_cast<int>(generator() % 11) - 3});
+    };
+    for (int document_id = 0; document_id < 2'000; ++document_id) {
+        add_random_document(document_id);
+    }
+    const size_t result_count = 2'000;
+    const auto check = [&] {
+        for (const string& query : {"w1 w2 w3"s, "w0 w9 w13 -w5"s, "w4 w7"s, "w11 w12 -w3 -w6"s}) {
+            // рейтинги документов от -3 до 7: диапазоны фильтров захватывают края и пересекают их
+            for (const DocumentFilter& filter : {DocumentFilter{DocumentStatus::ACTUAL}, DocumentFilter{DocumentStatus::BANNED, 2, 5},
+                                                 DocumentFilter{DocumentStatus::REMOVED, -10, -3}, DocumentFilter{DocumentStatus::IRRELEVANT, 7, 20}}) {
+                const auto predicate = [filter](int document_id, DocumentStatus status, int rating) {
+                    return filter(document_id, status, rating);
+                };
+                const auto expected = search_server.FindTopDocuments(query, predicate, result_count);
+                ASSERT(!expected.empty());
+                AssertSameDocuments(expected, search_server.FindTopDocuments(query, filter, result_count));
+                AssertSameDocuments(search_server.FindTopDocuments(execution::par, query, predicate, result_count),
+                                    search_server.FindTopDocuments(execution::par, query, filter, result_count));
+                AssertSameDocuments(search_server.FindTopDocumentsWithAllWords(query, predicate, result_count),
+                                    search_server.FindTopDocumentsWithAllWords(query, filter, result_count));
+            }
+        }
+    };
+    check();
+    // после удаления границы рейтинга участков пересчитываются, после добавления — расширяются
+    for (int document_id = 0; document_id < 2'000; document_id += 3) {
+        search_server.RemoveDocument(document_id);
+    }
+    for (int document_id = 2'000; document_id < 2'300; ++document_id) {
+        add_random_document(document_id);
+    }
+    check();
+    search_server.CompressPostings();
+    check();
+}
+
+void TestCompressedPostingsMatchUncompressed() {
+    SearchServer search_server = MakeRandomServer(2'000, 40, 20);
+    search_server.AddDocument(5'000, "w1 w2 w3 w3"s, DocumentStatus::BANNED, {3});
+    const size_t result_count = 2'100;
+    // w50 нет в словаре; в режиме «все слова» такой запрос ничего не находит
+    const vector<string> queries = {"w1 w2 w3"s, "w0 w9 w13 -w5"s, "w3 w3 w17 -w30 -w31"s, "w1 w38 w39"s, "w7 w50"s};
+    const auto search = [&queries, result_count](const SearchServer& server) {
+        vector<vector<Document>> results;
+        for (const string& query : queries) {
+            results.push_back(server.FindTopDocuments(query, DocumentFilter{}, result_count));
+            results.push_back(server.FindTopDocuments(execution::par, query, DocumentFilter{}, result_count));
+            results.push_back(server.FindTopDocuments(query, [](int document_id, DocumentStatus, int) { return document_id % 2 == 0; }, result_count));
+            results.push_back(server.FindTopDocumentsWithAllWords(query, DocumentFilter{}, result_count));
+            results.push_back(server.FindTopDocumentsWithAllWords(query, DocumentStatus::BANNED));
+        }
+        return results;
+    };
+    const auto assert_same = [](const vector<vector<Document>>& expected, const vector<vector<Document>>& actual) {
+        ASSERT_EQUAL(expected.size(), actual.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            AssertSameDocuments(expected[i], actual[i]);
+        }
+    };
+    const auto expected = search(search_server);
+    ASSERT(!expected[0].empty() && !expected[3].empty() && !expected[4].empty());
+
+    search_server.CompressPostings();
+    ASSERT(search_server.ArePostingsCompressed());
+    assert_same(expected, search(search_server));
+
+    const string path = (filesystem::temp_directory_path() / "search_server_tests.index").string();
+    search_server.SaveIndex(path);
+    const SearchServer loaded = SearchServer::LoadIndex(path);
+    filesystem::remove(path);
+    ASSERT(!loaded.ArePostingsCompressed());
+    assert_same(expected, search(loaded));
+
+    // изменение индекса распаковывает все списки
+    search_server.AddDocument(5'001, "w1 w2"s, DocumentStatus::ACTUAL, {1});
+    ASSERT(!search_server.ArePostingsCompressed());
+    search_server.CompressPostings();
+    search_server.RemoveDocument(5'001);
+    ASSERT(!search_server.ArePostingsCompressed());
+    assert_same(expected, search(search_server));
+}
+
+void TestAllWordsModeMatchesReference() {
+    SearchServer search_server = MakeRandomServer(3'000, 40, 12);
+    // rare встречается только в документах с id больше, чем у всех документов со словами w*:
+    // самый короткий участок кончается раньше остальных, а поиск прыжками уходит за конец длинных
+    search_server.AddDocument(10'000, "rare w1 w2"s, DocumentStatus::ACTUAL, {5});
+    search_server.AddDocument(10'001, "rare w1 w3"s, DocumentStatus::ACTUAL, {6});
+    search_server.AddDocument(10'002, "rare w1 w2"s, DocumentStatus::BANNED, {7});
+    search_server.AddDocument(10'003, "rare"s, DocumentStatus::ACTUAL, {8});
+    const size_t result_count = 4'000;
+    const auto check = [&](const string& query, const vector<string>& plus_words) {
+        for (const DocumentStatus status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+            // документы со всеми плюс-словами; OR-поиск по ним даёт тот же набор и ту же релевантность
+            // с точностью до порядка сложения вкладов
+            const auto has_all_words = [&](int document_id, DocumentStatus document_status, int) {
+                const auto word_freqs = search_server.GetWordFrequencies(document_id);
+                return document_status == status && all_of(plus_words.begin(), plus_words.end(), [&word_freqs](const string& word) {
+                    return word_freqs.count(word) > 0;
+                });
+            };
+            const auto expected = search_server.FindTopDocuments(query, has_all_words, result_count);
+            const auto actual = search_server.FindTopDocumentsWithAllWords(query, DocumentFilter{status}, result_count);
+            ASSERT(status != DocumentStatus::ACTUAL || !expected.empty());
+            ASSERT_EQUAL(expected.size(), actual.size());
+            for (size_t i = 0; i < expected.size(); ++i) {
+                ASSERT_EQUAL(expected[i].id, actual[i].id);
+                ASSERT(abs(expected[i].relevance - actual[i].relevance) < 1e-12);
+            }
+            AssertSameDocuments(actual, search_server.FindTopDocumentsWithAllWords(query, [status](int, DocumentStatus document_status, int) {
+                return document_status == status;
+            }, result_count));
+        }
+    };
+    for (const bool compressed : {false, true}) {
+        if (compressed) {
+            search_server.CompressPostings();
+        }
+        check("w1 w2"s, {"w1"s, "w2"s});
+        check("w1 w2 w3 -w4 -w5"s, {"w1"s, "w2"s, "w3"s});
+        check("w1 and w2 -w7"s, {"w1"s, "w2"s});
+        check("rare w1"s, {"rare"s, "w1"s});
+        check("w1 w2 rare -w3"s, {"w1"s, "w2"s, "rare"s});
+        ASSERT_EQUAL(search_server.FindTopDocumentsWithAllWords("w1 rare -w3"s).size(), 1u);
+        ASSERT_EQUAL(search_server.FindTopDocumentsWithAllWords("rare w2"s, DocumentStatus::BANNED).at(0).id, 10'002);
+        // слова нет в индексе: AND-запрос ничего не находит, а OR-запрос находит документы с w1
+        ASSERT(search_server.FindTopDocumentsWithAllWords("w1 w99"s).empty());
+        ASSERT(!search_server.FindTopDocuments("w1 w99"s).empty());
+        // все плюс-слова — минус-слова того же запроса
+        ASSERT(search_server.FindTopDocumentsWithAllWords("w1 -w1"s).empty());
+    }
+}
+
+// Побайтовое разбиение по пробелам, с которым сравнивается блочный TokenizeWords
+vector<string> SplitIntoWordsScalar(const string& text) {
+    vector<string> words;
+    string word;
+    for (const char c : text) {
+        if (c == ' ') {
+            if (!word.empty()) {
+                words.push_back(word);
+            }
+            word.clear();
+        } else {
+            word += c;
+        }
+    }
+    if (!word.empty()) {
+        words.push_back(word);
+    }
+    return words;
+}
+
+void TestSplitIntoWordsMatchesScalar() {
+    const auto check = [](const string& text) {
+        const auto expected = SplitIntoWordsScalar(text);
+        const auto words = SplitIntoWords(text);
+        ASSERT_EQUAL(words.size(), expected.size());
+        for (size_t i = 0; i < words.size(); ++i) {
+            ASSERT_EQUAL(string(words[i]), expected[i]);
+            ASSERT(words[i].data() >= text.data() && words[i].data() + words[i].size() <= text.data() + text.size());
+        }
+        const auto invalid_word = find_if(expected.begin(), expected.end(), [](const string& word) {
+            return !IsValidWord(word);
+        });
+        string error;
+        try {
+            ASSERT(SplitIntoValidWords(text).size() == expected.size());
+        } catch (const invalid_argument& e) {
+            error = e.what();
+        }
+        // сообщение называет первое слово с управляющим символом
+        ASSERT_EQUAL(error, invalid_word == expected.end() ? ""s : "Word "s + *invalid_word + " is invalid"s);
+    };
+
+    // длины вокруг границ блоков SSE2 (16 байт) и AVX2 (32 байта) и неполный последний блок
+    const string word_chars = "ab\xc3\xa9\x80\xff"s;
+    for (size_t length = 0; length <= 70; ++length) {
+        for (const size_t space_position : {size_t{0}, size_t{15}, size_t{16}, size_t{31}, size_t{32}, length / 2, length - 1}) {
+            string text;
+            for (size_t i = 0; i < length; ++i) {
+                text += i == space_position ? ' ' : word_chars[i % word_chars.size()];
+            }
+            check(text);
+            if (length > 0) {
+                check(string(length, ' '));
+                check(" "s + text + "  "s);
+            }
+        }
+    }
+
+    mt19937 generator(29);
+    // пробелы подряд, байты от 0x80 и управляющие символы, в том числе на стыке блоков
+    const string alphabet = "  ab-\x80\xc3\xff\t\n\x01\x1f"s;
+    for (int i = 0; i < 3'000; ++i) {
+        string text(generator() % 100, ' ');
+        for (char& c : text) {
+            c = alphabet[generator() % (i % 2 == 0 ? 8 : alphabet.size())];
+        }
+        check(text);
+    }
+    check("word\tafter"s + string(30, ' ') + "tail"s);
+    check(string(31, 'a') + "\x1f"s + string(31, 'b'));
+    check(string(63, 'a') + " "s + "\x7f\x01"s);
+}
+
+void TestRemoveDocument() {
+    const size_t result_count = 400;
+    const vector<string> queries = {"w1 w2 w3"s, "w0 w9 w13 -w5"s, "w4 w7"s};
+    const auto search = [&queries, result_count](const SearchServer& server) {
+        vector<vector<Document>> results;
+        for (const string& query : queries) {
+            results.push_back(server.FindTopDocuments(query, DocumentFilter{}, result_count));
+            results.push_back(server.FindTopDocumentsWithAllWords(query, DocumentFilter{}, result_count));
+        }
+        return results;
+    };
+    const auto assert_same = [](const vector<vector<Document>>& expected, const vector<vector<Document>>& actual) {
+        ASSERT_EQUAL(expected.size(), actual.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            AssertSameDocuments(expected[i], actual[i]);
+        }
+    };
+    // слова в словаре удалённого и недобавленного документа получают разные id, поэтому вклады
+    // слов складываются в разном порядке и релевантность совпадает лишь с точностью до округления
+    const auto assert_close = [](const vector<vector<Document>>& expected, const vector<vector<Document>>& actual) {
+        ASSERT_EQUAL(expected.size(), actual.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQUAL(expected[i].size(), actual[i].size());
+            for (size_t j = 0; j < expected[i].size(); ++j) {
+                ASSERT_EQUAL(expected[i][j].id, actual[i][j].id);
+                ASSERT(abs(expected[i][j].relevance - actual[i][j].relevance) < 1e-12);
+                ASSERT_EQUAL(expected[i][j].rating, actual[i][j].rating);
+            }
+        }
+    };
+    const vector<int> removed_ids = {0, 17, 150, 299};
+
+    SearchServer reference = MakeRandomServer(300, 20, 8, set<int>(removed_ids.begin(), removed_ids.end()));
+    SearchServer search_server = MakeRandomServer(300, 20, 8);
+    const auto w1_frequencies = search_server.GetWordFrequencies(1);
+    ASSERT(!w1_frequencies.empty());
+
+    search_server.RemoveDocument(execution::par, 0);
+    search_server.RemoveDocument(execution::seq, 17);
+    search_server.RemoveDocuments(execution::par, {150, 299});
+    const auto expected = search(search_server);
+    ASSERT(!expected[0].empty() && !expected[1].empty());
+    assert_close(search(reference), expected);
+    SearchServer removed_sequentially = MakeRandomServer(300, 20, 8);
+    for (const int document_id : removed_ids) {
+        removed_sequentially.RemoveDocument(document_id);
+    }
+    assert_same(expected, search(removed_sequentially));
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 296);
+    for (const int document_id : removed_ids) {
+        ASSERT(search_server.GetWordFrequencies(document_id).empty());
+        ASSERT(search_server.GetWordIdFrequencies(document_id).empty());
+        ASSERT(find(search_server.begin(), search_server.end(), document_id) == search_server.end());
+        bool thrown = false;
+        try {
+            search_server.MatchDocument("w1"s, document_id);
+        } catch (const out_of_range&) {
+            thrown = true;
+        }
+        ASSERT(thrown);
+    }
+    ASSERT(search_server.GetWordFrequencies(1) == w1_frequencies);
+    for (const auto& results : search(search_server)) {
+        for (const Document& document : results) {
+            ASSERT(find(removed_ids.begin(), removed_ids.end(), document.id) == removed_ids.end());
+        }
+    }
+
+    // повторное удаление и отсутствующий id ничего не меняют
+    search_server.RemoveDocument(17);
+    search_server.RemoveDocument(100'000);
+    search_server.RemoveDocument(execution::par, -1);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 296);
+    assert_same(expected, search(search_server));
+
+    // id освобождается и принимается снова
+    search_server.AddDocument(17, "w1 w2 w3"s, DocumentStatus::ACTUAL, {4});
+    reference.AddDocument(17, "w1 w2 w3"s, DocumentStatus::ACTUAL, {4});
+    assert_close(search(reference), search(search_server));
+    ASSERT_EQUAL(search_server.GetWordFrequencies(17).size(), 3u);
+}
+
+void TestMovedServerKeepsIndex() {
+    SearchServer source("and"s);
+    source.AddDocument(1, "white cat and collar"s, DocumentStatus::ACTUAL, {8});
+    source.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7});
+    const auto expected = source.FindTopDocuments("fluffy cat"s);
+    const SearchServer moved(std::move(source));
+    AssertSameDocuments(expected, moved.FindTopDocuments("fluffy cat"s));
+    const auto [words, status] = moved.MatchDocument("fluffy cat -collar"s, 2);
+    ASSERT_EQUAL(words.size(), 2u);
+    ASSERT_EQUAL(words[0], "cat"s);
+    ASSERT(moved.GetWordFrequencies(1).count("collar"s) > 0);
+}
+
+void TestRemoveDuplicates() {
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7});
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(3, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(4, "funny pet and curly hair"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(5, "funny funny pet and nasty nasty rat"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(6, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(7, "very nasty rat and not very funny pet"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(8, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(9, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, {1});
+    const vector<int> removed_ids = RemoveDuplicates(search_server);
+    ASSERT(removed_ids == vector<int>({3, 4, 5, 7}));
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 5);
+}
+
+void TestConcurrentServerMatchesSearchServer() {
+    mt19937 generator(23);
+    uniform_int_distribution<int> word_distribution(0, 29);
+    SearchServer search_server("and in"s);
+    ConcurrentSearchServer concurrent_server("and in"s, 4);
+    for (int document_id = 0; document_id < 500; ++document_id) {
+        string document;
+        for (int i = 0; i < 12; ++i) {
+            document += "w"s + to_string(word_distribution(generator)) + " "s;
+        }
+        const DocumentStatus status = document_id % 5 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        search_server.AddDocument(document_id, document, status, {document_id % 11});
+        concurrent_server.AddDocument(document_id, document, status, {document_id % 11});
+    }
+    ASSERT_EQUAL(concurrent_server.GetDocumentCount(), search_server.GetDocumentCount());
+    const auto odd_rating = [](int, DocumentStatus, int rating) {
+        return rating % 2 == 1;
+    };
+    for (const string& query : {"w1 w2 w3"s, "w0 w7 -w5"s, "w4 w4 w28 w29"s}) {
+        AssertSameDocuments(search_server.FindTopDocuments(query), concurrent_server.FindTopDocuments(query));
+        AssertSameDocuments(search_server.FindTopDocuments(query, DocumentStatus::BANNED),
+                            concurrent_server.FindTopDocuments(query, DocumentStatus::BANNED));
+        AssertSameDocuments(search_server.FindTopDocuments(query, odd_rating, 50),
+                            concurrent_server.FindTopDocuments(query, odd_rating, 50));
+        AssertSameDocuments(search_server.FindTopDocuments<Bm25Ranking>(query, DocumentFilter{}, 20),
+                            concurrent_server.FindTopDocuments<Bm25Ranking>(query, DocumentFilter{}, 20));
+    }
+}
+
+void TestConcurrentServerSeesOnlyPublishedDocuments() {
+    const int document_count = 2'000;
+    ConcurrentSearchServer search_server(""s, 8);
+    // слово common есть во всех документах, поэтому при согласованных числе документов
+    // и частоте слова его IDF, а значит и релевантность, равны нулю
+    thread writer([&search_server] {
+        for (int document_id = 0; document_id < document_count; ++document_id) {
+            search_server.AddDocument(document_id, "common w"s + to_string(document_id % 13), DocumentStatus::ACTUAL, {1});
+        }
+    });
+    bool consistent = true;
+    while (search_server.GetDocumentCount() < document_count) {
+        for (const Document& document : search_server.FindTopDocuments("common"s, DocumentFilter{}, document_count)) {
+            consistent = consistent && document.relevance == 0.0;
+        }
+    }
+    writer.join();
+    ASSERT(consistent);
+    ASSERT_EQUAL(search_server.FindTopDocuments("common"s, DocumentFilter{}, document_count).size(), size_t(document_count));
+}
+
+string ReadFile(const string& path) {
+    ifstream in(path, ios::binary);
+    return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+bool IsIndexRejected(const string& path, const string& index) {
+    ofstream(path, ios::binary | ios::trunc) << index;
+    try {
+        SearchServer::LoadIndex(path);
+    } catch (const runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+void TestLoadIndexRejectsCorruptedCounts() {
+    const string path = (filesystem::temp_directory_path() / "search_server_tests.index").string();
+    SearchServer search_server = MakeRandomServer(50, 20, 10);
+    search_server.SaveIndex(path);
+    const string index = ReadFile(path);
+    ASSERT_EQUAL(SearchServer::LoadIndex(path).GetDocumentCount(), 50);
+
+    // stop_word_count, word_count, posting_count и document_count идут в заголовке после magic, version и posting_size
+    for (size_t count_offset = 16; count_offset <= 40; count_offset += 8) {
+        for (const uint64_t count : {UINT64_MAX, UINT64_MAX / 8, uint64_t(1) << 40}) {
+            string modified_index = index;
+            memcpy(modified_index.data() + count_offset, &count, sizeof(count));
+            ASSERT(IsIndexRejected(path, modified_index));
+        }
+    }
+    ASSERT(IsIndexRejected(path, index.substr(0, index.size() / 2)));
+    filesystem::remove(path);
+}
+
+void TestLoadIndexRejectsCorruptedRecords() {
+    const string path = (filesystem::temp_directory_path() / "search_server_tests.index").string();
+    SearchServer search_server(""s);
+    // вхождения слова cat — первые три записи секции вхождений: документы 0, 1 и 2
+    search_server.AddDocument(0, "cat dog"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(1, "cat"s, DocumentStatus::BANNED, {2});
+    search_server.AddDocument(2, "cat bird"s, DocumentStatus::ACTUAL, {3});
+    // документ без слов сохраняется с word_count == 0 и загружается обратно
+    search_server.AddDocument(3, ""s, DocumentStatus::ACTUAL, {4});
+    search_server.SaveIndex(path);
+    const string index = ReadFile(path);
+    ASSERT_EQUAL(SearchServer::LoadIndex(path).GetDocumentCount(), 4);
+
+    // вхождение — {id, reserved, term_freq} по 16 байт, документ — {id, rating, status, word_count};
+    // документы лежат в конце файла, вхождения — прямо перед ними
+    uint64_t posting_count = 0;
+    uint64_t document_count = 0;
+    memcpy(&posting_count, index.data() + 32, sizeof(posting_count));
+    memcpy(&document_count, index.data() + 40, sizeof(document_count));
+    const size_t documents_offset = index.size() - document_count * 16;
+    const size_t postings_offset = documents_offset - posting_count * 16;
+    const auto modify = [](string modified_index, size_t offset, int32_t value) {
+        memcpy(modified_index.data() + offset, &value, sizeof(value));
+        return modified_index;
+    };
+    const auto document_field = [documents_offset](size_t document_index, size_t field_index) {
+        return documents_offset + document_index * 16 + field_index * 4;
+    };
+    const auto posting_id = [postings_offset](size_t posting_index) {
+        return postings_offset + posting_index * 16;
+    };
+
+    ASSERT(IsIndexRejected(path, modify(index, document_field(0, 0), -1)));
+    ASSERT(IsIndexRejected(path, modify(index, document_field(1, 0), 0)));
+    ASSERT(IsIndexRejected(path, modify(index, document_field(0, 2), static_cast<int32_t>(DocumentStatus::REMOVED) + 1)));
+    ASSERT(IsIndexRejected(path, modify(index, document_field(0, 2), -1)));
+    ASSERT(IsIndexRejected(path, modify(index, document_field(0, 3), -2)));
+    ASSERT(IsIndexRejected(path, modify(index, document_field(0, 3), 0)));
+    // id вхождений cat: 1, 0, 2 — не по возрастанию; 0, 0, 2 — повтор
+    ASSERT(IsIndexRejected(path, modify(modify(index, posting_id(0), 1), posting_id(1), 0)));
+    ASSERT(IsIndexRejected(path, modify(index, posting_id(1), 0)));
+    filesystem::remove(path);
+}
+
+void TestLoadCorpusIsAllOrNothing() {
+    const string path = (filesystem::temp_directory_path() / "search_server_tests.tsv").string();
+    const auto write_corpus = [&path](const string& corpus) {
+        ofstream(path, ios::binary) << corpus;
+    };
+    // при пачках по 2 документа первые пачки добавляются раньше, чем читается последняя строка
+    const string valid_lines = "10\t0\t1 2 3\twhite cat\n11\t0\t4\tfluffy cat\r\n\n12\t2\t\tdog\n13\t0\t-5 5\tcat and dog\n"s;
+    SearchServer search_server("and"s);
+    search_server.AddDocument(5, "parrot"s, DocumentStatus::ACTUAL, {1});
+    for (const string& invalid_line : {"14\t4\t1\tcat\n"s, "14\t0\tx\tcat\n"s, "14\t0\t1\n"s, "-1\t0\t1\tcat\n"s,
+                                       "11\t0\t1\tcat\n"s, "5\t0\t1\tcat\n"s, "14\t0\t1\tcat\tcollar\n"s, "14\t0\t1\tcat\x01\n"s}) {
+        write_corpus(valid_lines + invalid_line);
+        bool thrown = false;
+        try {
+            LoadCorpus(search_server, path, 2);
+        } catch (const invalid_argument& e) {
+            thrown = true;
+            // номер строки считается вместе с пустой
+            ASSERT(string(e.what()).find("line 6 "s) != string::npos);
+        }
+        ASSERT(thrown);
+        ASSERT_EQUAL(search_server.GetDocumentCount(), 1);
+    }
+
+    write_corpus(valid_lines);
+    ASSERT_EQUAL(LoadCorpus(search_server, path, 2), 4u);
+    filesystem::remove(path);
+    SearchServer expected("and"s);
+    expected.AddDocument(5, "parrot"s, DocumentStatus::ACTUAL, {1});
+    expected.AddDocument(10, "white cat"s, DocumentStatus::ACTUAL, {1, 2, 3});
+    expected.AddDocument(11, "fluffy cat"s, DocumentStatus::ACTUAL, {4});
+    expected.AddDocument(12, "dog"s, DocumentStatus::BANNED, {});
+    expected.AddDocument(13, "cat and dog"s, DocumentStatus::ACTUAL, {-5, 5});
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 5);
+    for (const string& query : {"cat"s, "dog"s, "fluffy parrot"s}) {
+        AssertSameDocuments(expected.FindTopDocuments(query, DocumentFilter{}, 10), search_server.FindTopDocuments(query, DocumentFilter{}, 10));
+        AssertSameDocuments(expected.FindTopDocuments(query, DocumentStatus::BANNED), search_server.FindTopDocuments(query, DocumentStatus::BANNED));
+    }
+}
+
+void TestQueryResultCacheKeysDoNotCollide() {
+    SearchServer search_server(""s);
+    search_server.AddDocument(1, "cat a |"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "cat dog"s, DocumentStatus::BANNED, {2});
+    search_server.AddDocument(3, "a"s, DocumentStatus::ACTUAL, {3});
+    QueryResultCache cache(search_server);
+    const auto banned = [](int, DocumentStatus status, int) {
+        return status == DocumentStatus::BANNED;
+    };
+    // тег совпадает с тем, которым кэш помечает фильтр по статусу ACTUAL
+    ASSERT_EQUAL(cache.FindTopDocuments("cat"s, "status:0"s, banned).at(0).id, 2);
+    ASSERT_EQUAL(cache.FindTopDocuments("cat"s).at(0).id, 1);
+    // без длин минус-слово "|" и тег "x" давали тот же ключ, что тег " |x" без минус-слов
+    ASSERT_EQUAL(cache.FindTopDocuments("a -|"s, "x"s, DocumentFilter{}).size(), 1u);
+    ASSERT_EQUAL(cache.FindTopDocuments("a"s, " |x"s, DocumentFilter{}).size(), 2u);
+    ASSERT_EQUAL(cache.GetHitCount(), 0u);
+}
+
+void TestQueryResultCacheMatchesServerAfterChanges() {
+    SearchServer search_server(""s);
+    search_server.AddDocument(1, "cat collar"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "dog"s, DocumentStatus::ACTUAL, {2});
+    QueryResultCache cache(search_server);
+    // parrot нет в словаре, пока его не добавит документ
+    const vector<string> queries = {"cat"s, "dog"s, "parrot"s, "dog -tail"s};
+    const auto check = [&] {
+        for (const string& query : queries) {
+            AssertSameDocuments(search_server.FindTopDocuments(query), cache.FindTopDocuments(query));
+            AssertSameDocuments(search_server.FindTopDocuments(query), cache.FindTopDocuments(query));
+        }
+    };
+    check();
+    ASSERT_EQUAL(cache.GetSize(), queries.size());
+    ASSERT_EQUAL(cache.GetHitCount(), queries.size());
+    const double dog_relevance = cache.FindTopDocuments("dog"s).at(0).relevance;
+
+    // в новом документе нет слова dog, но IDF dog зависит от числа документов
+    cache.AddDocument(3, "cat parrot tail"s, DocumentStatus::ACTUAL, {3});
+    ASSERT_EQUAL(cache.GetSize(), 0u);
+    check();
+    ASSERT(cache.FindTopDocuments("dog"s).at(0).relevance != dog_relevance);
+
+    cache.RemoveDocument(1);
+    ASSERT_EQUAL(cache.GetSize(), 0u);
+    check();
+    // удаление отсутствующего документа индекс не меняет, и кэш сохраняется
+    cache.RemoveDocument(1);
+    ASSERT_EQUAL(cache.GetSize(), queries.size());
+    ASSERT_EQUAL(cache.GetMissCount(), 3 * queries.size());
+}
+
+void TestPreparedQueryMatchesRawQuery() {
+    SearchServer search_server("and"s);
+    search_server.AddDocument(1, "white cat and collar"s, DocumentStatus::ACTUAL, {8});
+    search_server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7});
+    search_server.AddDocument(3, "groomed dog and collar"s, DocumentStatus::BANNED, {5});
+    const auto check = [&search_server](const string& raw_query) {
+        const auto query = search_server.PrepareQuery(raw_query);
+        AssertSameDocuments(search_server.FindTopDocuments(raw_query), search_server.FindTopDocuments(query));
+        AssertSameDocuments(search_server.FindTopDocuments(raw_query, DocumentStatus::BANNED),
+                            search_server.FindTopDocuments(execution::par, query, DocumentStatus::BANNED));
+        AssertSameDocuments(search_server.FindTopDocumentsWithAllWords(raw_query), search_server.FindTopDocumentsWithAllWords(query));
+        for (int document_id : search_server) {
+            ASSERT(search_server.MatchDocument(raw_query, document_id) == search_server.MatchDocument(query, document_id));
+        }
+    };
+    for (const string& raw_query : {"cat"s, "collar and -dog"s, "fluffy cat -cat"s, "parrot"s, "collar parrot -beak"s}) {
+        check(raw_query);
+    }
+
+    // слова, которых не было в словаре при разборе, находятся после добавления документов
+    const auto plus_unknown = search_server.PrepareQuery("cat parrot"s);
+    const auto minus_unknown = search_server.PrepareQuery("cat -beak"s);
+    ASSERT_EQUAL(plus_unknown.unknown_plus_words.size(), 1u);
+    search_server.AddDocument(4, "parrot"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(5, "cat beak"s, DocumentStatus::ACTUAL, {1});
+    AssertSameDocuments(search_server.FindTopDocuments("cat parrot"s), search_server.FindTopDocuments(plus_unknown));
+    AssertSameDocuments(search_server.FindTopDocuments("cat -beak"s), search_server.FindTopDocuments(minus_unknown));
+    ASSERT_EQUAL(search_server.FindTopDocuments(plus_unknown).size(), 4u);
+    ASSERT_EQUAL(search_server.FindTopDocuments(minus_unknown).size(), 2u);
+    ASSERT(get<0>(search_server.MatchDocument(minus_unknown, 5)).empty());
+}
+
+void TestPreparedQueryCache() {
+    SearchServer search_server(""s);
+    search_server.AddDocument(1, "cat collar"s, DocumentStatus::ACTUAL, {1});
+    PreparedQueryCache cache(search_server, 2);
+    const auto cat = cache.Get("cat"s);
+    ASSERT(cache.Get("cat"s) == cat);
+    cache.Get("collar"s);
+    // cat использовался позже collar, поэтому вытесняется collar
+    ASSERT(cache.Get("cat"s) == cat);
+    cache.Get("dog"s);
+    ASSERT(cache.Get("cat"s) == cat);
+    ASSERT_EQUAL(cache.GetSize(), 2u);
+    ASSERT_EQUAL(cache.GetHitCount(), 3u);
+    cache.Get("collar"s);
+    ASSERT_EQUAL(cache.GetMissCount(), 4u);
+    AssertSameDocuments(search_server.FindTopDocuments("cat"s), search_server.FindTopDocuments(*cat));
+
+    bool thrown = false;
+    try {
+        cache.Get("cat --collar"s);
+    } catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+    ASSERT_EQUAL(cache.GetSize(), 2u);
+
+    thrown = false;
+    try {
+        PreparedQueryCache empty_cache(search_server, 0);
+    } catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+}
+
+void TestRequestQueueEvictsOldestRequests() {
+    SearchServer search_server(""s);
+    search_server.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, {1});
+    RequestQueue request_queue(search_server);
+    ASSERT_EQUAL(request_queue.GetLatencyPercentile(50).count(), 0);
+
+    // окно — последние 1440 запросов; модель хранит их целиком
+    const size_t window = 1440;
+    deque<bool> model;
+    mt19937 generator(31);
+    for (int i = 0; i < 5'000; ++i) {
+        // длинные серии пустых и непустых запросов проходят через границу окна
+        const bool is_empty = (i / 700 + generator() % 5) % 2 == 0;
+        ASSERT_EQUAL(request_queue.AddFindRequest(is_empty ? "dog"s : "cat"s).empty(), is_empty);
+        model.push_back(is_empty);
+        if (model.size() > window) {
+            model.pop_front();
+        }
+        ASSERT_EQUAL(request_queue.GetNoResultRequests(), count(model.begin(), model.end(), true));
+    }
+
+    bool thrown = false;
+    try {
+        request_queue.GetLatencyPercentile(101);
+    } catch (const invalid_argument&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+    ASSERT(request_queue.GetLatencyPercentile(0) <= request_queue.GetLatencyPercentile(100));
+}
+
+void TestPaginator() {
+    const list<int> values = {1, 2, 3, 4, 5, 6, 7};
+    const auto pages = Paginate(values, 3);
+    using PageIterator = decltype(pages.begin());
+    static_assert(is_same_v<iterator_traits<PageIterator>::iterator_category, input_iterator_tag>);
+    ASSERT_EQUAL(pages.size(), 3u);
+    vector<long> page_sizes;
+    for (const auto& page : pages) {
+        page_sizes.push_back(page.size());
+    }
+    ASSERT(page_sizes == vector<long>({3, 3, 1}));
+    ASSERT_EQUAL(*pages.Page(2).begin(), 7);
+    ASSERT_EQUAL(*pages[1].begin(), 4);
+}
+
+// IDF равен единице, поэтому релевантность — сумма TF слов запроса
+struct TermFrequencyRanking {
+    static double ComputeInverseDocumentFreq(int, int) {
+        return 1.0;
+    }
+
+    static double ComputeTermRelevance(double term_freq, int, double, double inverse_document_freq) {
+        return term_freq * inverse_document_freq;
+    }
+};
+
+void TestRankingPolicySuppliesInverseDocumentFreq() {
+    SearchServer search_server(""s);
+    search_server.AddDocument(1, "cat cat dog bird"s, DocumentStatus::ACTUAL, {1});
+    search_server.AddDocument(2, "cat dog"s, DocumentStatus::ACTUAL, {2});
+    search_server.AddDocument(3, "fish"s, DocumentStatus::ACTUAL, {3});
+    for (const bool precomputed : {false, true}) {
+        if (precomputed) {
+            search_server.PrecomputeInverseDocumentFreqs();
+        }
+        const auto tf_idf = search_server.FindTopDocuments("cat"s);
+        ASSERT_EQUAL(tf_idf.size(), 2u);
+        ASSERT(tf_idf[0].relevance == 0.5 * log(3.0 / 2.0));
+        const auto term_freq = search_server.FindTopDocuments<TermFrequencyRanking>("cat"s);
+        ASSERT_EQUAL(term_freq.size(), 2u);
+        ASSERT_EQUAL(term_freq[0].id, 2);
+        ASSERT(term_freq[0].relevance == 0.5);
+        // кэш IDF одной политики не подменяет значения другой
+        AssertSameDocuments(tf_idf, search_server.FindTopDocuments("cat"s));
+    }
+}
+
+void TestThrowingPredicateLeavesNoState() {
+    SearchServer search_server = MakeRandomServer(300, 12, 6);
+    const size_t result_count = 300;
+    const auto expected_plus = search_server.FindTopDocuments("w2 w3"s, DocumentFilter{}, result_count);
+    const auto expected_minus = search_server.FindTopDocuments("w1 w2"s, DocumentFilter{}, result_count);
+    ASSERT(!expected_plus.empty() && !expected_minus.empty());
+
+    int call_count = 0;
+    const auto throwing_predicate = [&call_count](int, DocumentStatus, int) {
+        if (++call_count == 20) {
+            throw runtime_error("predicate failed");
+        }
+        return true;
+    };
+    // минус-слово w2 успевает пометить документы до исключения
+    bool thrown = false;
+    try {
+        search_server.FindTopDocuments("w1 w3 -w2"s, throwing_predicate, result_count);
+    } catch (const runtime_error&) {
+        thrown = true;
+    }
+    ASSERT(thrown);
+    AssertSameDocuments(expected_plus, search_server.FindTopDocuments("w2 w3"s, DocumentFilter{}, result_count));
+    AssertSameDocuments(expected_minus, search_server.FindTopDocuments("w1 w2"s, DocumentFilter{}, result_count));
+}
+
+void TestPreparedQueryBelongsToServer() {
+    SearchServer source("and"s);
+    source.AddDocument(1, "white cat and collar"s, DocumentStatus::ACTUAL, {8});
+    source.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7});
+    SearchServer other("and"s);
+    other.AddDocument(1, "dog"s, DocumentStatus::ACTUAL, {1});
+    const auto query = source.PrepareQuery("fluffy collar -tail"s);
+
+    const auto is_rejected = [&query](const auto& use) {
+        try {
+            use(query);
+        } catch (const invalid_argument&) {
+            return true;
+        }
+        return false;
+    };
+    // id слов из словаря source лежат за пределами словаря other
+    ASSERT(is_rejected([&other](const auto& prepared) { other.FindTopDocuments(prepared); }));
+    ASSERT(is_rejected([&other](const auto& prepared) { other.FindTopDocuments(execution::par, prepared); }));
+    ASSERT(is_rejected([&other](const auto& prepared) { other.FindTopDocumentsWithAllWords(prepared); }));
+    ASSERT(is_rejected([&other](const auto& prepared) { other.MatchDocument(prepared, 1); }));
+    ASSERT(is_rejected([&source](const auto&) { source.FindTopDocuments(SearchServer::PreparedQuery{}); }));
+
+    // перемещённый сервер остаётся тем же сервером
+    const auto expected = source.FindTopDocuments(query);
+    ASSERT_EQUAL(expected.size(), 1u);
+    SearchServer moved(std::move(source));
+    AssertSameDocuments(expected, moved.FindTopDocuments(query));
+}
+
+int main() {
+    TestRunner tr;
+    RUN_TEST(tr, TestParallelRelevanceMatchesSequential);
+    RUN_TEST(tr, TestDocumentFilterMatchesPredicate);
+    RUN_TEST(tr, TestCompressedPostingsMatchUncompressed);
+    RUN_TEST(tr, TestAllWordsModeMatchesReference);
+    RUN_TEST(tr, TestSplitIntoWordsMatchesScalar);
+    RUN_TEST(tr, TestRemoveDocument);
+    RUN_TEST(tr, TestMovedServerKeepsIndex);
+    RUN_TEST(tr, TestRemoveDuplicates);
+    RUN_TEST(tr, TestConcurrentServerMatchesSearchServer);
+    RUN_TEST(tr, TestConcurrentServerSeesOnlyPublishedDocuments);
+    RUN_TEST(tr, TestLoadIndexRejectsCorruptedCounts);
+    RUN_TEST(tr, TestLoadIndexRejectsCorruptedRecords);
+    RUN_TEST(tr, TestLoadCorpusIsAllOrNothing);
+    RUN_TEST(tr, TestQueryResultCacheKeysDoNotCollide);
+    RUN_TEST(tr, TestQueryResultCacheMatchesServerAfterChanges);
+    RUN_TEST(tr, TestRequestQueueEvictsOldestRequests);
+    RUN_TEST(tr, TestPaginator);
+    RUN_TEST(tr, TestRankingPolicySuppliesInverseDocumentFreq);
+    RUN_TEST(tr, TestThrowingPredicateLeavesNoState);
+    RUN_TEST(tr, TestPreparedQueryBelongsToServer);
+    RUN_TEST(tr, TestPreparedQueryMatchesRawQuery);
+    RUN_TEST(tr, TestPreparedQueryCache);
+    return tr.GetFailCount() == 0 ? 0 : 1;
+}